@@ -0,0 +1,115 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "CompletionPrefetch.h"
+#include "Metrics.h"
+
+CompletionPrefetch::CompletionPrefetch(ScintillaGateway &editor, int budget) : editor(editor), budget(budget) {
+}
+
+void CompletionPrefetch::SetBudget(int budget) {
+	this->budget = budget;
+}
+
+void CompletionPrefetch::Trigger(LspClient *client, int position) {
+	Discard();
+
+	if (!WithinBudget()) {
+		Metrics::Global().Increment("completion.prefetch.throttled");
+		return;
+	}
+
+	// Guessing ahead only makes things worse for a server that is already behind
+	if (client->isSaturated()) {
+		Metrics::Global().Increment("completion.prefetch.shed");
+		return;
+	}
+
+	this->client = client;
+	this->position = position;
+
+	Metrics::Global().Increment("completion.prefetch.issued");
+
+	in_flight = client->requestCompletion(position, [this](const json &completions) {
+		in_flight = -1;
+		ready = !completions.is_null();
+		result = completions;
+	});
+}
+
+bool CompletionPrefetch::Take(LspClient *client, int word_start, json &result) {
+	auto &metrics = Metrics::Global();
+	bool hit = false;
+	bool joined = IsPending(client, word_start);
+
+	if (joined) {
+		// It was asked for a bit too early, the caller joins it rather than waiting here
+		metrics.Increment("completion.prefetch.joined");
+	}
+	else {
+		if (client == this->client && word_start == position && ready) {
+			result = std::move(this->result);
+			hit = true;
+		}
+
+		Discard();
+	}
+
+	metrics.Increment(hit || joined ? "completion.prefetch.hits" : "completion.prefetch.misses");
+
+	long long hits = metrics.Get("completion.prefetch.hits");
+	long long total = hits + metrics.Get("completion.prefetch.misses");
+	metrics.Set("completion.prefetch.hit_rate_percent", hits * 100 / total);
+
+	return hit;
+}
+
+bool CompletionPrefetch::IsPending(LspClient *client, int word_start) const {
+	return client != nullptr && client == this->client && word_start == position && in_flight != -1;
+}
+
+void CompletionPrefetch::Modified(int position) {
+	// Anything before the trigger position invalidates the result
+	if (this->position != -1 && position < this->position)
+		Discard();
+}
+
+void CompletionPrefetch::Discard() {
+	if (client && in_flight != -1)
+		client->cancelRequest(in_flight);
+
+	client = nullptr;
+	position = -1;
+	in_flight = -1;
+	ready = false;
+	result = json();
+}
+
+bool CompletionPrefetch::WithinBudget() {
+	DWORD now = GetTickCount();
+
+	while (!issued.empty() && now - issued.front() >= 1000)
+		issued.pop_front();
+
+	if ((int)issued.size() >= budget)
+		return false;
+
+	issued.push_back(now);
+
+	return true;
+}
@@ -0,0 +1,63 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <deque>
+
+#include "ScintillaGateway.h"
+#include "LspClient.h"
+
+// Speculatively requests completions when a trigger character is typed so
+// the results are already available by the time they are asked for
+class CompletionPrefetch final {
+public:
+	explicit CompletionPrefetch(ScintillaGateway &editor, int budget = 5);
+
+	// Maximum number of speculative requests issued per second
+	void SetBudget(int budget);
+
+	// A trigger character was typed and the caret is now at position
+	void Trigger(LspClient *client, int position);
+
+	// Uses the prefetched result if it was requested for this word start. If it is still
+	// on its way it is kept until Discard() is called, so that requesting completions
+	// at the word start in the meantime joins it instead of asking the server again.
+	bool Take(LspClient *client, int word_start, json &result);
+
+	// The prefetch for this word start has been requested but not answered yet
+	bool IsPending(LspClient *client, int word_start) const;
+
+	// The document changed at position
+	void Modified(int position);
+
+	void Discard();
+
+private:
+	ScintillaGateway &editor;
+	LspClient *client = nullptr;
+	int position = -1;
+	int in_flight = -1;
+	bool ready = false;
+	json result;
+
+	int budget;
+	std::deque<DWORD> issued;
+
+	bool WithinBudget();
+};
@@ -0,0 +1,144 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "CompletionResolver.h"
+
+CompletionResolver::CompletionResolver(ScintillaGateway &editor, size_t capacity) : editor(editor), capacity(capacity) {
+}
+
+void CompletionResolver::Reset(LspClient *client, std::vector<json> items) {
+	Cancel();
+
+	this->client = client;
+	this->items = std::move(items);
+}
+
+void CompletionResolver::Highlight(int index) {
+	if (client == nullptr || index < 0 || index >= (int)items.size() || index == highlighted)
+		return;
+
+	highlighted = index;
+
+	// The user scrolled past whatever was being resolved
+	if (in_flight != -1) {
+		client->cancelRequest(in_flight);
+		in_flight = -1;
+	}
+
+	// Words that did not come from the server
+	if (items[index].is_null()) {
+		editor.CallTipCancel();
+		return;
+	}
+
+	std::string key = items[index].dump();
+	const json *resolved = Lookup(key);
+	if (resolved) {
+		Show(*resolved);
+		return;
+	}
+
+	editor.CallTipCancel();
+
+	in_flight = client->requestCompletionResolve(items[index], [this, index, key](const json &item) {
+		in_flight = -1;
+
+		if (item.is_null())
+			return;
+
+		Store(key, item);
+
+		if (index == highlighted && editor.AutoCActive())
+			Show(item);
+	});
+}
+
+void CompletionResolver::Cancel() {
+	if (client && in_flight != -1)
+		client->cancelRequest(in_flight);
+
+	in_flight = -1;
+	highlighted = -1;
+	items.clear();
+
+	editor.CallTipCancel();
+	editor.CallTipSetPosition(false);
+}
+
+void CompletionResolver::Show(const json &item) const {
+	std::string text;
+
+	auto detail = item.find("detail");
+	if (detail != item.end() && detail->is_string())
+		text = detail->get<std::string>();
+
+	// Documentation is either a plain string or MarkupContent
+	auto documentation = item.find("documentation");
+	if (documentation != item.end()) {
+		std::string doc;
+
+		if (documentation->is_string())
+			doc = documentation->get<std::string>();
+		else if (documentation->is_object() && documentation->find("value") != documentation->end())
+			doc = (*documentation)["value"].get<std::string>();
+
+		if (!doc.empty()) {
+			if (!text.empty())
+				text += "\n\n";
+			text += doc;
+		}
+	}
+
+	if (text.empty()) {
+		editor.CallTipCancel();
+		return;
+	}
+
+	// Keep it out of the way of the list
+	editor.CallTipSetPosition(true);
+	editor.CallTipShow(editor.AutoCPosStart(), text);
+}
+
+const json *CompletionResolver::Lookup(const std::string &key) {
+	auto it = cache.find(key);
+	if (it == cache.end())
+		return nullptr;
+
+	// Move it to the front since it was most recently used
+	lru.splice(lru.begin(), lru, it->second);
+
+	return &it->second->second;
+}
+
+void CompletionResolver::Store(const std::string &key, const json &item) {
+	auto it = cache.find(key);
+	if (it != cache.end()) {
+		it->second->second = item;
+		lru.splice(lru.begin(), lru, it->second);
+		return;
+	}
+
+	lru.emplace_front(key, item);
+	cache[key] = lru.begin();
+
+	// Evict the least recently used
+	if (lru.size() > capacity) {
+		cache.erase(lru.back().first);
+		lru.pop_back();
+	}
+}
@@ -0,0 +1,59 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ScintillaGateway.h"
+#include "LspClient.h"
+
+// Lazily resolves the documentation of the highlighted autocompletion item
+class CompletionResolver final {
+public:
+	explicit CompletionResolver(ScintillaGateway &editor, size_t capacity = 256);
+
+	// A new autocompletion list has been shown with these items
+	void Reset(LspClient *client, std::vector<json> items);
+
+	// The item at this index of the list is now highlighted
+	void Highlight(int index);
+
+	// The autocompletion list has gone away
+	void Cancel();
+
+private:
+	typedef std::list<std::pair<std::string, json>> LruList;
+
+	ScintillaGateway &editor;
+	LspClient *client = nullptr;
+	std::vector<json> items;
+	int highlighted = -1;
+	int in_flight = -1;
+
+	size_t capacity;
+	LruList lru;
+	std::unordered_map<std::string, LruList::iterator> cache;
+
+	void Show(const json &item) const;
+	const json *Lookup(const std::string &key);
+	void Store(const std::string &key, const json &item);
+};
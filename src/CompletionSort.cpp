@@ -0,0 +1,166 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "CompletionSort.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <numeric>
+
+// Each item gets a fixed size key that can be radix sorted:
+//   [ sortText prefix ... ][ match score ][ kind priority ]
+static const size_t SORT_TEXT_BYTES = 14;
+static const size_t KEY_BYTES = SORT_TEXT_BYTES + 2;
+
+// Indexed by CompletionItemKind, lower values are shown first
+static const unsigned char kind_priority[] = {
+	9, // unknown
+	9, // text
+	1, // method
+	1, // function
+	2, // constructor
+	0, // field
+	0, // variable
+	3, // class
+	3, // interface
+	4, // module
+	0, // property
+	5, // unit
+	5, // value
+	3, // enum
+	7, // keyword
+	8, // snippet
+	5, // color
+	6, // file
+	6, // reference
+	6, // folder
+	0, // enum member
+	0, // constant
+	3, // struct
+	2, // event
+	5, // operator
+	3, // type parameter
+};
+
+static const std::string empty;
+
+static const std::string &StringField(const json &item, const char *field, const char *fallback) {
+	auto it = item.find(field);
+	if (it != item.end() && it->is_string())
+		return it->get_ref<const std::string &>();
+
+	it = item.find(fallback);
+	if (it != item.end() && it->is_string())
+		return it->get_ref<const std::string &>();
+
+	return empty;
+}
+
+static unsigned char MatchScore(const std::string &text, const std::string &typed) {
+	if (typed.empty() || text.compare(0, typed.length(), typed) == 0)
+		return 0;
+
+	auto ieq = [](char a, char b) { return std::tolower((unsigned char)a) == std::tolower((unsigned char)b); };
+
+	if (text.length() >= typed.length() && std::equal(typed.begin(), typed.end(), text.begin(), ieq))
+		return 1;
+	if (std::search(text.begin(), text.end(), typed.begin(), typed.end(), ieq) != text.end())
+		return 2;
+
+	return 3;
+}
+
+static unsigned char KindPriority(const json &item) {
+	auto kind = item.find("kind");
+	if (kind == item.end() || !kind->is_number_integer())
+		return kind_priority[0];
+
+	int k = kind->get<int>();
+	if (k < 0 || k >= (int)sizeof(kind_priority))
+		return kind_priority[0];
+
+	return kind_priority[k];
+}
+
+std::vector<unsigned int> SortCompletionItems(const json &items, const std::string &typed) {
+	const size_t n = items.size();
+	std::vector<unsigned char> keys(n * KEY_BYTES, 0);
+	std::vector<const std::string *> sort_texts(n);
+	bool truncated = false;
+
+	for (size_t i = 0; i < n; ++i) {
+		const json &item = items[i];
+		unsigned char *key = &keys[i * KEY_BYTES];
+
+		const std::string &sort_text = StringField(item, "sortText", "label");
+		sort_texts[i] = &sort_text;
+		memcpy(key, sort_text.data(), std::min(sort_text.length(), SORT_TEXT_BYTES));
+		truncated |= sort_text.length() > SORT_TEXT_BYTES;
+
+		key[SORT_TEXT_BYTES] = MatchScore(StringField(item, "filterText", "label"), typed);
+		key[SORT_TEXT_BYTES + 1] = KindPriority(item);
+	}
+
+	std::vector<unsigned int> order(n);
+	std::vector<unsigned int> scratch(n);
+	std::iota(order.begin(), order.end(), 0);
+
+	// LSD radix sort, one byte of the key at a time. Each pass is stable so
+	// the earlier (less significant) passes are kept for equal bytes.
+	for (size_t b = KEY_BYTES; b-- > 0;) {
+		size_t counts[257] = { 0 };
+
+		for (size_t i = 0; i < n; ++i)
+			counts[keys[order[i] * KEY_BYTES + b] + 1]++;
+
+		// Nothing to do if every key has the same byte here, which is common for the padding
+		if (std::find(counts + 1, counts + 257, n) != counts + 257)
+			continue;
+
+		for (size_t c = 1; c < 257; ++c)
+			counts[c] += counts[c - 1];
+
+		for (size_t i = 0; i < n; ++i)
+			scratch[counts[keys[order[i] * KEY_BYTES + b]]++] = order[i];
+
+		order.swap(scratch);
+	}
+
+	if (!truncated)
+		return order;
+
+	// Items with a long sortText may only be ordered by its prefix, fix up those runs
+	auto full_compare = [&](unsigned int a, unsigned int b) {
+		int c = sort_texts[a]->compare(*sort_texts[b]);
+		if (c != 0)
+			return c < 0;
+		return memcmp(&keys[a * KEY_BYTES + SORT_TEXT_BYTES], &keys[b * KEY_BYTES + SORT_TEXT_BYTES], KEY_BYTES - SORT_TEXT_BYTES) < 0;
+	};
+
+	size_t run = 0;
+	for (size_t i = 1; i <= n; ++i) {
+		if (i == n || memcmp(&keys[order[run] * KEY_BYTES], &keys[order[i] * KEY_BYTES], SORT_TEXT_BYTES) != 0) {
+			if (i - run > 1)
+				std::stable_sort(order.begin() + run, order.begin() + i, full_compare);
+			run = i;
+		}
+	}
+
+	return order;
+}
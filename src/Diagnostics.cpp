@@ -0,0 +1,486 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "Diagnostics.h"
+#include "Metrics.h"
+
+#include <map>
+#include <tuple>
+
+// Indexed by DiagnosticSeverity
+static const int indicators[] = { 0, 13, 14, 15, 16 };
+static const char *severities[] = { "", "error", "warning", "info", "hint" };
+
+static inline int Severity(int severity) {
+	return severity >= 1 && severity <= 4 ? severity : 1;
+}
+
+bool Diagnostic::operator<(const Diagnostic &other) const {
+	return std::tie(start_line, start_character, end_line, end_character, severity, message) <
+		std::tie(other.start_line, other.start_character, other.end_line, other.end_character, other.severity, other.message);
+}
+
+bool Diagnostic::operator==(const Diagnostic &other) const {
+	return std::tie(start_line, start_character, end_line, end_character, severity, message) ==
+		std::tie(other.start_line, other.start_character, other.end_line, other.end_character, other.severity, other.message);
+}
+
+static bool ReadPosition(const json &range, const char *name, int &line, int &character) {
+	auto position = range.find(name);
+	if (position == range.end() || !position->is_object())
+		return false;
+
+	auto l = position->find("line");
+	auto c = position->find("character");
+	if (l == position->end() || c == position->end() || !l->is_number_integer() || !c->is_number_integer())
+		return false;
+
+	line = l->get<int>();
+	character = c->get<int>();
+	return line >= 0 && character >= 0;
+}
+
+DiagnosticSet::DiagnosticSet(const json &diagnostics) {
+	items.reserve(diagnostics.size());
+
+	for (const auto &d : diagnostics) {
+		Diagnostic diagnostic;
+
+		// Built on the pool, so anything malformed is skipped rather than thrown on
+		auto range = d.find("range");
+		if (range == d.end() || !range->is_object() ||
+			!ReadPosition(*range, "start", diagnostic.start_line, diagnostic.start_character) ||
+			!ReadPosition(*range, "end", diagnostic.end_line, diagnostic.end_character)) {
+			Metrics::Global().Increment("diagnostics.malformed");
+			continue;
+		}
+
+		auto severity = d.find("severity");
+		auto message = d.find("message");
+		diagnostic.severity = Severity(severity != d.end() && severity->is_number_integer() ? severity->get<int>() : 1);
+		diagnostic.message = message != d.end() && message->is_string() ? message->get<std::string>() : std::string();
+
+		items.push_back(std::move(diagnostic));
+	}
+
+	Index();
+}
+
+static inline int ShiftLine(int l, int line, int lines_added) {
+	if (lines_added > 0)
+		return l > line ? l + lines_added : l;
+
+	// Lines after the given line were removed
+	if (l > line - lines_added)
+		return l + lines_added;
+	return l > line ? line : l;
+}
+
+void DiagnosticSet::ShiftLines(int line, int lines_added) {
+	for (auto &d : items) {
+		d.start_line = ShiftLine(d.start_line, line, lines_added);
+		d.end_line = ShiftLine(d.end_line, line, lines_added);
+	}
+
+	Index();
+}
+
+void DiagnosticSet::Index() {
+	std::sort(items.begin(), items.end());
+
+	max_end.resize(items.size());
+	for (size_t i = 0; i < items.size(); ++i)
+		max_end[i] = i == 0 ? items[i].end_line : std::max(max_end[i - 1], items[i].end_line);
+}
+
+void LineRanges::Add(int first, int last) {
+	std::vector<std::pair<int, int>> merged;
+	merged.reserve(ranges.size() + 1);
+
+	bool added = false;
+	for (const auto &range : ranges) {
+		if (range.second + 1 < first) {
+			merged.push_back(range);
+		}
+		else if (range.first > last + 1) {
+			if (!added) {
+				merged.emplace_back(first, last);
+				added = true;
+			}
+			merged.push_back(range);
+		}
+		else {
+			// Overlaps or touches, grow the new range
+			first = std::min(first, range.first);
+			last = std::max(last, range.second);
+		}
+	}
+
+	if (!added)
+		merged.emplace_back(first, last);
+
+	ranges.swap(merged);
+}
+
+std::vector<std::pair<int, int>> LineRanges::Missing(int first, int last) const {
+	std::vector<std::pair<int, int>> missing;
+
+	for (const auto &range : ranges) {
+		if (range.second < first)
+			continue;
+		if (range.first > last)
+			break;
+
+		if (range.first > first)
+			missing.emplace_back(first, range.first - 1);
+		first = range.second + 1;
+	}
+
+	if (first <= last)
+		missing.emplace_back(first, last);
+
+	return missing;
+}
+
+std::vector<std::pair<int, int>> LineRanges::Present(int first, int last) const {
+	std::vector<std::pair<int, int>> present;
+
+	for (const auto &range : ranges) {
+		if (range.second < first)
+			continue;
+		if (range.first > last)
+			break;
+
+		present.emplace_back(std::max(first, range.first), std::min(last, range.second));
+	}
+
+	return present;
+}
+
+void LineRanges::ShiftLines(int line, int lines_added) {
+	auto old = std::move(ranges);
+	ranges.clear();
+
+	for (const auto &range : old)
+		Add(ShiftLine(range.first, line, lines_added), ShiftLine(range.second, line, lines_added));
+}
+
+DiagnosticsEngine::DiagnosticsEngine(ScintillaGateway &editor, PositionIndex &positions) : editor(editor), positions(positions) {
+}
+
+void DiagnosticsEngine::Setup(const ScintillaGateway &view) {
+	static const int styles[] = { 0, INDIC_SQUIGGLE, INDIC_SQUIGGLE, INDIC_DOTS, INDIC_DOTS };
+	static const Colour colours[] = { 0, 0x0000FF, 0x0080FF, 0xFF8000, 0x808080 };
+
+	for (int severity = 1; severity <= 4; ++severity) {
+		view.IndicSetStyle(indicators[severity], styles[severity]);
+		view.IndicSetFore(indicators[severity], colours[severity]);
+		view.IndicSetUnder(indicators[severity], true);
+	}
+
+	view.AnnotationSetVisible(ANNOTATION_BOXED);
+}
+
+void DiagnosticsEngine::Publish(const std::string &uri, const json &diagnostics, PositionIndex::Encoding encoding) {
+	Publish(uri, DiagnosticSet(diagnostics), encoding);
+}
+
+void DiagnosticsEngine::Publish(const std::string &uri, DiagnosticSet &&diagnostics, PositionIndex::Encoding encoding) {
+	Metrics::Global().Increment("diagnostics.published");
+
+	UriId id = uris.Intern(uri);
+	auto &document = documents[id];
+	size_t before = document.latest.Size();
+	document.latest = std::move(diagnostics);
+	document.encoding = encoding;
+
+	for (int severity = 1; severity <= 4; ++severity) {
+		workspace_counts[severity] -= document.counts[severity];
+		document.counts[severity] = 0;
+	}
+	for (const auto &d : document.latest.Items())
+		document.counts[d.severity]++;
+	for (int severity = 1; severity <= 4; ++severity)
+		workspace_counts[severity] += document.counts[severity];
+
+	if (before != document.latest.Size())
+		rows_dirty = true;
+
+	// Anything else gets applied once it is shown
+	if (id == current)
+		Apply(document);
+}
+
+void DiagnosticsEngine::SetCurrent(const std::string &uri) {
+	// Interned even if nothing was published for it yet, so the first publish is applied right away
+	current = uri.empty() ? no_uri : uris.Intern(uri);
+
+	Document *document = CurrentDocument();
+	if (document)
+		Apply(*document);
+}
+
+void DiagnosticsEngine::Close(const std::string &uri) {
+	UriId id;
+	if (!uris.Find(uri, id))
+		return;
+
+	auto it = documents.find(id);
+	if (it == documents.end())
+		return;
+
+	// Nothing is displayed for it anymore
+	it->second.applied = DiagnosticSet();
+	it->second.rendered.Clear();
+
+	if (id == current)
+		current = no_uri;
+}
+
+void DiagnosticsEngine::Modified(int line, int lines_added) {
+	Document *document = CurrentDocument();
+	if (document == nullptr)
+		return;
+
+	// Keep the line numbers in sync with where Scintilla moved the indicators to
+	document->applied.ShiftLines(line, lines_added);
+	document->latest.ShiftLines(line, lines_added);
+	document->rendered.ShiftLines(line, lines_added);
+}
+
+void DiagnosticsEngine::UpdateViewport() {
+	Document *document = CurrentDocument();
+	if (document == nullptr)
+		return;
+
+	int first_visible = editor.GetFirstVisibleLine();
+	int lines_on_screen = editor.LinesOnScreen();
+
+	// Include a screen's worth above and below so small scrolls are already done
+	int first = std::max(editor.DocLineFromVisible(first_visible) - lines_on_screen, 0);
+	int last = std::min(editor.DocLineFromVisible(first_visible + lines_on_screen) + lines_on_screen, editor.GetLineCount() - 1);
+
+	for (const auto &range : document->rendered.Missing(first, last))
+		Render(*document, range.first, range.second, false);
+}
+
+std::vector<int> DiagnosticsEngine::Counts() const {
+	const Document *document = CurrentDocument();
+	if (document == nullptr)
+		return std::vector<int>(5, 0);
+
+	return std::vector<int>(document->counts, document->counts + 5);
+}
+
+std::vector<int> DiagnosticsEngine::WorkspaceCounts() const {
+	return std::vector<int>(workspace_counts, workspace_counts + 5);
+}
+
+void DiagnosticsEngine::GotoNext(bool forward) {
+	Document *document = CurrentDocument();
+	if (document == nullptr || document->latest.Size() == 0)
+		return;
+
+	const auto &items = document->latest.Items();
+	int pos = editor.GetCurrentPos();
+	int line, character;
+	positions.ToLsp(pos, line, character, document->encoding);
+	auto caret = std::make_pair(line, character);
+	auto before = [](const std::pair<int, int> &p, const Diagnostic &d) { return p < std::make_pair(d.start_line, d.start_character); };
+	auto after = [](const Diagnostic &d, const std::pair<int, int> &p) { return std::make_pair(d.start_line, d.start_character) < p; };
+
+	const Diagnostic *d;
+	if (forward) {
+		auto it = std::upper_bound(items.begin(), items.end(), caret, before);
+		d = it != items.end() ? &*it : &items.front();
+	}
+	else {
+		auto it = std::lower_bound(items.begin(), items.end(), caret, after);
+		d = it != items.begin() ? &*(it - 1) : &items.back();
+	}
+
+	Select(*d);
+}
+
+void DiagnosticsEngine::Select(const Diagnostic &d) {
+	const Document *document = CurrentDocument();
+	if (document == nullptr)
+		return;
+
+	int start = Position(*document, d.start_line, d.start_character);
+	int end = Position(*document, d.end_line, d.end_character);
+
+	editor.EnsureVisibleEnforcePolicy(d.start_line);
+	editor.SetSel(end, start);
+}
+
+size_t DiagnosticsEngine::Rows() const {
+	IndexRows();
+	return row_ends.empty() ? 0 : row_ends.back();
+}
+
+const Diagnostic *DiagnosticsEngine::Row(size_t row, UriId &uri) const {
+	IndexRows();
+
+	auto it = std::upper_bound(row_ends.begin(), row_ends.end(), row);
+	if (it == row_ends.end())
+		return nullptr;
+
+	size_t index = it - row_ends.begin();
+	size_t start = index == 0 ? 0 : row_ends[index - 1];
+
+	uri = row_uris[index];
+	return &documents.at(uri).latest.Items()[row - start];
+}
+
+void DiagnosticsEngine::IndexRows() const {
+	if (!rows_dirty)
+		return;
+
+	row_uris.clear();
+	row_ends.clear();
+
+	for (const auto &document : documents) {
+		if (document.second.latest.Size() > 0)
+			row_uris.push_back(document.first);
+	}
+
+	std::sort(row_uris.begin(), row_uris.end(), [this](UriId a, UriId b) { return uris.Get(a) < uris.Get(b); });
+
+	size_t end = 0;
+	for (UriId uri : row_uris) {
+		end += documents.at(uri).latest.Size();
+		row_ends.push_back(end);
+	}
+
+	rows_dirty = false;
+}
+
+DiagnosticsEngine::Document *DiagnosticsEngine::CurrentDocument() {
+	auto it = documents.find(current);
+	return it != documents.end() ? &it->second : nullptr;
+}
+
+const DiagnosticsEngine::Document *DiagnosticsEngine::CurrentDocument() const {
+	auto it = documents.find(current);
+	return it != documents.end() ? &it->second : nullptr;
+}
+
+void DiagnosticsEngine::Apply(Document &document) {
+	const auto &before = document.applied.Items();
+	const auto &after = document.latest.Items();
+
+	// Both are sorted so walk through them together to find the lines that changed
+	std::vector<std::pair<int, int>> dirty;
+	size_t i = 0, j = 0;
+	while (i < before.size() || j < after.size()) {
+		if (i < before.size() && j < after.size() && before[i] == after[j]) {
+			++i;
+			++j;
+		}
+		else if (j == after.size() || (i < before.size() && before[i] < after[j])) {
+			dirty.emplace_back(before[i].start_line, before[i].end_line);
+			++i;
+		}
+		else {
+			dirty.emplace_back(after[j].start_line, after[j].end_line);
+			++j;
+		}
+	}
+
+	Metrics::Global().Increment(dirty.empty() ? "diagnostics.unchanged" : "diagnostics.changed");
+
+	std::sort(dirty.begin(), dirty.end());
+
+	for (size_t k = 0; k < dirty.size();) {
+		int first = dirty[k].first;
+		int last = dirty[k].second;
+
+		for (++k; k < dirty.size() && dirty[k].first <= last + 1; ++k)
+			last = std::max(last, dirty[k].second);
+
+		// Lines that have not been rendered yet will be done when they are scrolled to
+		for (const auto &range : document.rendered.Present(first, last))
+			Render(document, range.first, range.second, true);
+	}
+
+	document.applied = document.latest;
+
+	UpdateViewport();
+}
+
+void DiagnosticsEngine::Render(Document &document, int first, int last, bool clear) {
+	int line_count = editor.GetLineCount();
+	if (first >= line_count)
+		return;
+	last = std::min(last, line_count - 1);
+
+	document.rendered.Add(first, last);
+
+	Metrics::Global().Increment("diagnostics.lines_updated", last - first + 1);
+
+	int start = editor.PositionFromLine(first);
+	int end = editor.GetLineEndPosition(last);
+
+	// Lines that were never rendered have nothing to clear
+	if (clear) {
+		for (int severity = 1; severity <= 4; ++severity) {
+			editor.SetIndicatorCurrent(indicators[severity]);
+			editor.IndicatorClearRange(start, end - start);
+		}
+	}
+
+	std::map<int, std::string> annotations;
+
+	document.latest.ForEachOnLines(first, last, [&](const Diagnostic &d) {
+		int s = std::max(Position(document, d.start_line, d.start_character), start);
+		int e = std::min(Position(document, d.end_line, d.end_character), end);
+
+		// Make sure empty ranges are still visible
+		if (e <= s)
+			e = std::min(s + 1, end);
+
+		if (e > s) {
+			editor.SetIndicatorCurrent(indicators[d.severity]);
+			editor.IndicatorFillRange(s, e - s);
+		}
+
+		if (d.start_line >= first) {
+			std::string &annotation = annotations[d.start_line];
+			if (!annotation.empty())
+				annotation += '\n';
+			annotation += severities[d.severity];
+			annotation += ": ";
+			annotation += d.message;
+		}
+	});
+
+	if (clear) {
+		for (int line = first; line <= last; ++line) {
+			if (annotations.find(line) == annotations.end())
+				editor.AnnotationSetText(line, static_cast<const char *>(nullptr));
+		}
+	}
+
+	for (const auto &annotation : annotations)
+		editor.AnnotationSetText(annotation.first, annotation.second);
+}
+
+int DiagnosticsEngine::Position(const Document &document, int line, int character) {
+	return positions.FromLsp(line, character, document.encoding);
+}
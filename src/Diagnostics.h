@@ -0,0 +1,183 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ScintillaGateway.h"
+#include "Uri.h"
+#include "PositionIndex.h"
+#include "json.hpp"
+
+using namespace nlohmann;
+
+struct Diagnostic {
+	int start_line;
+	int start_character;
+	int end_line;
+	int end_character;
+	int severity;
+	std::string message;
+
+	bool operator<(const Diagnostic &other) const;
+	bool operator==(const Diagnostic &other) const;
+};
+
+// Diagnostics sorted by their start so the ones touching a range of lines can be found quickly
+class DiagnosticSet final {
+public:
+	DiagnosticSet() {}
+	explicit DiagnosticSet(const json &diagnostics);
+
+	const std::vector<Diagnostic> &Items() const { return items; }
+	size_t Size() const { return items.size(); }
+
+	// Lines were added (or removed if negative) after the given line
+	void ShiftLines(int line, int lines_added);
+
+	template<typename F>
+	void ForEachOnLines(int first, int last, F f) const {
+		// Everything starting after the last line can be skipped, then walk backwards
+		// until no earlier diagnostic can reach the first line
+		auto it = std::upper_bound(items.begin(), items.end(), last, [](int line, const Diagnostic &d) { return line < d.start_line; });
+		for (size_t i = it - items.begin(); i-- > 0;) {
+			if (max_end[i] < first)
+				break;
+			if (items[i].end_line >= first)
+				f(items[i]);
+		}
+	}
+
+private:
+	std::vector<Diagnostic> items;
+
+	// The furthest end line of any diagnostic up to and including this index
+	std::vector<int> max_end;
+
+	void Index();
+};
+
+// A sorted set of non-overlapping line ranges
+class LineRanges final {
+public:
+	void Clear() { ranges.clear(); }
+	void Add(int first, int last);
+
+	// The parts of [first, last] that are not in the set
+	std::vector<std::pair<int, int>> Missing(int first, int last) const;
+
+	// The parts of [first, last] that are in the set
+	std::vector<std::pair<int, int>> Present(int first, int last) const;
+
+	void ShiftLines(int line, int lines_added);
+
+private:
+	std::vector<std::pair<int, int>> ranges;
+};
+
+// Displays diagnostics in the editor. Each new set is compared with what is
+// currently displayed and only the lines that changed are touched. Lines are
+// only rendered once they are near the visible part of the document.
+//
+// Diagnostics are kept for every uri the servers publish them for, not just the
+// open documents, so they can also be listed for the whole workspace.
+class DiagnosticsEngine final {
+public:
+	DiagnosticsEngine(ScintillaGateway &editor, PositionIndex &positions);
+
+	// Sets up the indicators for a Scintilla view
+	static void Setup(const ScintillaGateway &view);
+
+	void Publish(const std::string &uri, const json &diagnostics, PositionIndex::Encoding encoding);
+
+	// Parsing and sorting a set does not need the editor, so it can be done elsewhere
+	void Publish(const std::string &uri, DiagnosticSet &&diagnostics, PositionIndex::Encoding encoding);
+
+	// The document shown in the editor has changed, brings it up to date
+	void SetCurrent(const std::string &uri);
+
+	// The document is no longer open. Its diagnostics stay in the workspace
+	// but will need to be rendered again if it is reopened.
+	void Close(const std::string &uri);
+
+	// Lines were added or removed in the current document
+	void Modified(int line, int lines_added);
+
+	// The editor scrolled, renders anything that has come into view
+	void UpdateViewport();
+
+	// Number of diagnostics of each severity in the current document
+	std::vector<int> Counts() const;
+
+	// Number of diagnostics of each severity in all documents
+	std::vector<int> WorkspaceCounts() const;
+
+	// Selects the next/previous diagnostic from the caret
+	void GotoNext(bool forward);
+
+	// Selects the diagnostic in the current document
+	void Select(const Diagnostic &d);
+
+	// All diagnostics in the workspace as one list, grouped by uri
+	size_t Rows() const;
+	const Diagnostic *Row(size_t row, UriId &uri) const;
+
+	const UriTable &Uris() const { return uris; }
+
+private:
+	struct Document {
+		DiagnosticSet applied;
+		DiagnosticSet latest;
+
+		// The lines that are rendered in Scintilla
+		LineRanges rendered;
+
+		// Indexed by severity
+		int counts[5] = { 0 };
+
+		// How the server that published them counts characters
+		PositionIndex::Encoding encoding = PositionIndex::Utf16;
+	};
+
+	static const UriId no_uri = static_cast<UriId>(-1);
+
+	ScintillaGateway &editor;
+	PositionIndex &positions;
+	UriTable uris;
+	std::unordered_map<UriId, Document> documents;
+	UriId current = no_uri;
+	int workspace_counts[5] = { 0 };
+
+	// Rows are found by a binary search over where each document's rows end,
+	// rebuilt only after a publish changed the number of diagnostics
+	mutable std::vector<UriId> row_uris;
+	mutable std::vector<size_t> row_ends;
+	mutable bool rows_dirty = false;
+
+	Document *CurrentDocument();
+	const Document *CurrentDocument() const;
+
+	void Apply(Document &document);
+	void Render(Document &document, int first, int last, bool clear);
+	int Position(const Document &document, int line, int character);
+	void IndexRows() const;
+};
@@ -0,0 +1,119 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "DiagnosticsPuller.h"
+#include "Metrics.h"
+
+DiagnosticsPuller::DiagnosticsPuller(PublishHandler publish, int delay) : publish(publish), delay(delay) {
+}
+
+void DiagnosticsPuller::Edited() {
+	armed = true;
+	due = GetTickCount() + delay;
+}
+
+void DiagnosticsPuller::Tick(LspClient *client) {
+	if (client == nullptr || !client->hasPullDiagnostics())
+		return;
+
+	State &state = states[client];
+	if (state.in_flight != -1)
+		return;
+
+	// Up to date, or still being typed in
+	if (!client->isDirty() && client->getVersion() == state.version)
+		return;
+	if (armed) {
+		if ((int)(GetTickCount() - due) < 0)
+			return;
+		armed = false;
+	}
+
+	Metrics::Global().Increment("diagnostics.pull.requests");
+
+	state.in_flight = client->requestDiagnostic(state.result_id, [this, client](const json &result) {
+		auto it = states.find(client);
+		if (it == states.end())
+			return;
+
+		it->second.in_flight = -1;
+		if (result.is_object())
+			Report(client, client->getUri(), result, it->second.result_id);
+	});
+
+	// The request brought the server up to date with the document
+	state.version = client->getVersion();
+}
+
+void DiagnosticsPuller::Saved(LspClient *client) {
+	if (client == nullptr || !client->hasWorkspaceDiagnostics())
+		return;
+
+	State &state = states[client];
+	if (state.workspace_in_flight != -1)
+		return;
+
+	json previous = json::array();
+	for (const auto &result_id : state.workspace_result_ids)
+		previous.push_back({ { "uri", result_id.first }, { "value", result_id.second } });
+
+	Metrics::Global().Increment("diagnostics.pull.workspace_requests");
+
+	state.workspace_in_flight = client->requestWorkspaceDiagnostic(previous, [this, client](const json &result) {
+		auto it = states.find(client);
+		if (it == states.end())
+			return;
+
+		State &state = it->second;
+		state.workspace_in_flight = -1;
+
+		auto items = result.find("items");
+		if (items == result.end() || !items->is_array())
+			return;
+
+		for (const auto &report : *items) {
+			std::string uri = report.value("uri", std::string());
+			if (uri.empty())
+				continue;
+
+			std::string &result_id = uri == client->getUri() ? state.result_id : state.workspace_result_ids[uri];
+			Report(client, uri, report, result_id);
+		}
+	});
+}
+
+void DiagnosticsPuller::Remove(LspClient *client) {
+	states.erase(client);
+}
+
+void DiagnosticsPuller::Report(LspClient *client, const std::string &uri, const json &report, std::string &result_id) {
+	result_id = report.value("resultId", std::string());
+
+	// Nothing to parse or render, what is shown is still correct
+	if (report.value("kind", std::string()) == "unchanged") {
+		Metrics::Global().Increment("diagnostics.pull.unchanged");
+		return;
+	}
+
+	auto items = report.find("items");
+	if (items == report.end() || !items->is_array())
+		return;
+
+	Metrics::Global().Increment("diagnostics.pull.full");
+	publish(client, uri, *items);
+}
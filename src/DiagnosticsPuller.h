@@ -0,0 +1,73 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include "LspClient.h"
+
+// Asks servers that support pull diagnostics for them instead of waiting for them
+// to be published. Only the document being shown is pulled, and only once the
+// user has stopped typing for a moment. The resultId of the last report is sent
+// back with each request so the server can answer that nothing changed.
+class DiagnosticsPuller final {
+public:
+	typedef std::function<void(LspClient *client, const std::string &uri, const json &items)> PublishHandler;
+
+	explicit DiagnosticsPuller(PublishHandler publish, int delay = 300);
+
+	// How long to wait after the last edit before pulling
+	void SetDelay(int delay) { this->delay = delay; }
+
+	// The current document was edited
+	void Edited();
+
+	// Called every frame with the document being shown
+	void Tick(LspClient *client);
+
+	// The document was saved, other files may have been affected by it
+	void Saved(LspClient *client);
+
+	void Remove(LspClient *client);
+
+private:
+	struct State {
+		std::string result_id;
+		int version = -1;
+		int in_flight = -1;
+
+		// Last reports of the other documents the server told about
+		std::map<std::string, std::string> workspace_result_ids;
+		int workspace_in_flight = -1;
+	};
+
+	PublishHandler publish;
+	int delay;
+
+	// Only compared against while armed, the tick count wraps so an old deadline
+	// would otherwise look like it is still in the future half the time
+	bool armed = false;
+	DWORD due = 0;
+	std::unordered_map<LspClient *, State> states;
+
+	void Report(LspClient *client, const std::string &uri, const json &report, std::string &result_id);
+};
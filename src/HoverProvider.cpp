@@ -0,0 +1,154 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "HoverProvider.h"
+#include "Metrics.h"
+#include "UiDispatcher.h"
+#include "WorkPool.h"
+
+HoverProvider::HoverProvider(ScintillaGateway &editor) : editor(editor) {
+}
+
+void HoverProvider::DwellStart(LspClient *client, int position) {
+	int start = editor.WordStartPosition(position, true);
+	int end = editor.WordEndPosition(position, true);
+
+	// Not over a word
+	if (start == end)
+		return;
+
+	// Make sure the version is up to date before looking in the cache
+	client->notifyDidChange();
+	int version = client->getVersion();
+
+	if (client != cached_client || version != cached_version) {
+		cache.clear();
+		cached_client = client;
+		cached_version = version;
+	}
+
+	bool same_word = client == this->client && start == word_start && end == word_end;
+
+	if (showing && !same_word) {
+		editor.CallTipCancel();
+		showing = false;
+		shown.reset();
+	}
+
+	this->client = client;
+	word_start = start;
+	word_end = end;
+
+	auto it = cache.find(std::make_pair(start, end));
+	if (it != cache.end()) {
+		Metrics::Global().Increment("hover.cache_hits");
+		Show(position, it->second, 0);
+		return;
+	}
+
+	// Still waiting on the answer for this word
+	if (same_word && in_flight != -1)
+		return;
+
+	if (in_flight != -1)
+		client->cancelRequest(in_flight);
+
+	Metrics::Global().Increment("hover.requests");
+
+	unsigned int serial = client->getSerial();
+	in_flight = client->requestHover(position, [this, client, serial, version, start, end, position](const json &hover) {
+		in_flight = -1;
+
+		// Failed or timed out, nothing is shown and the next dwell asks again
+		if (hover.is_null())
+			return;
+
+		// Rendered on the pool, only showing it is left for the UI thread
+		json contents = hover.is_object() ? hover.value("contents", json()) : json();
+		WorkPool::Global().Submit([this, client, serial, version, start, end, position, contents]() {
+			auto rendered = contents.is_null() ? std::make_shared<const RenderedHover>() : renderer.Render(contents);
+
+			UiDispatcher::Global().Post([this, client, serial, version, start, end, position, rendered]() {
+				Rendered(client, serial, version, start, end, position, rendered);
+			});
+		});
+	});
+}
+
+void HoverProvider::Rendered(LspClient *client, unsigned int serial, int version, int start, int end, int position, std::shared_ptr<const RenderedHover> rendered) {
+	// The client may be long gone, it is only looked at once it is known to be the one still in use
+	if (client == cached_client && client->getSerial() == serial && version == cached_version)
+		cache[std::make_pair(start, end)] = rendered;
+
+	// The mouse may have moved on by now
+	if (client == this->client && client->getSerial() == serial && start == word_start && end == word_end && version == client->getVersion() && !client->isDirty())
+		Show(position, rendered, 0);
+	else
+		Metrics::Global().Increment("hover.stale");
+}
+
+void HoverProvider::DwellEnd() {
+	word_start = -1;
+	word_end = -1;
+
+	// Tips with more than one page stick around so the mouse can get to the arrows
+	if (showing && shown->pages.size() == 1) {
+		editor.CallTipCancel();
+		showing = false;
+		shown.reset();
+	}
+}
+
+void HoverProvider::CallTipClick(int position) {
+	if (!showing || !shown)
+		return;
+
+	if (position == 1 && page > 0)
+		Show(shown_position, shown, page - 1);
+	else if (position == 2 && page + 1 < shown->pages.size())
+		Show(shown_position, shown, page + 1);
+}
+
+void HoverProvider::Reset() {
+	if (client && in_flight != -1)
+		client->cancelRequest(in_flight);
+
+	DwellEnd();
+
+	client = nullptr;
+	in_flight = -1;
+	cached_client = nullptr;
+	cached_version = -1;
+	cache.clear();
+}
+
+void HoverProvider::Show(int position, std::shared_ptr<const RenderedHover> rendered, size_t page) {
+	if (rendered->pages.empty())
+		return;
+
+	const auto &p = rendered->pages[page];
+
+	editor.CallTipShow(position, p.text);
+	if (p.highlight_start != -1)
+		editor.CallTipSetHlt(p.highlight_start, p.highlight_end);
+
+	showing = true;
+	shown_position = position;
+	shown = rendered;
+	this->page = page;
+}
@@ -0,0 +1,65 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "ScintillaGateway.h"
+#include "LspClient.h"
+#include "HoverRenderer.h"
+
+// Shows hovers for the word under the mouse without blocking the editor
+class HoverProvider final {
+public:
+	explicit HoverProvider(ScintillaGateway &editor);
+
+	void DwellStart(LspClient *client, int position);
+	void DwellEnd();
+
+	// The up/down arrows of a hover with multiple pages were clicked
+	void CallTipClick(int position);
+
+	// Forget everything, e.g. when switching documents or closing one
+	void Reset();
+
+private:
+	ScintillaGateway &editor;
+
+	// What the mouse is currently over
+	LspClient *client = nullptr;
+	int word_start = -1;
+	int word_end = -1;
+	int in_flight = -1;
+	bool showing = false;
+	int shown_position = -1;
+	size_t page = 0;
+	std::shared_ptr<const RenderedHover> shown;
+
+	// Hovers for the words of a specific version of the document
+	LspClient *cached_client = nullptr;
+	int cached_version = -1;
+	std::map<std::pair<int, int>, std::shared_ptr<const RenderedHover>> cache;
+
+	HoverRenderer renderer;
+
+	void Rendered(LspClient *client, unsigned int serial, int version, int start, int end, int position, std::shared_ptr<const RenderedHover> rendered);
+	void Show(int position, std::shared_ptr<const RenderedHover> rendered, size_t page);
+};
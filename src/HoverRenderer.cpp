@@ -0,0 +1,386 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "HoverRenderer.h"
+#include "Metrics.h"
+
+#include <cctype>
+#include <cstring>
+
+static const size_t WRAP_WIDTH = 100;
+
+struct Line {
+	std::string text;
+	bool code;
+};
+
+// Normalizes everything into markdown
+static void AppendMarkdown(const json &contents, std::string &markdown) {
+	if (!markdown.empty() && markdown.back() != '\n')
+		markdown += "\n\n";
+
+	if (contents.is_string()) {
+		markdown += contents.get<std::string>();
+	}
+	else if (contents.is_array()) {
+		for (const auto &c : contents)
+			AppendMarkdown(c, markdown);
+	}
+	else if (contents.is_object()) {
+		auto value = contents.find("value");
+		if (value == contents.end() || !value->is_string())
+			return;
+
+		auto language = contents.find("language");
+		auto kind = contents.find("kind");
+
+		if (language != contents.end()) {
+			// MarkedString with a language is a code block
+			markdown += "```\n" + value->get<std::string>() + "\n```";
+		}
+		else if (kind != contents.end() && *kind == "plaintext") {
+			// Keep plain text from being interpreted as markdown
+			markdown += "```plaintext\n" + value->get<std::string>() + "\n```";
+		}
+		else {
+			markdown += value->get<std::string>();
+		}
+	}
+}
+
+// A piece of a line, either plain text or a run of emphasis delimiters
+struct Inline {
+	std::string text;
+	char delimiter;
+	size_t count;
+	bool can_open;
+	bool can_close;
+};
+
+static bool IsSpace(char c) {
+	return isspace((unsigned char)c) != 0;
+}
+
+static bool IsPunct(char c) {
+	return ispunct((unsigned char)c) != 0;
+}
+
+static bool IsWord(const std::string &s) {
+	for (char c : s) {
+		if (!isalnum((unsigned char)c) && c != '_')
+			return false;
+	}
+
+	return !s.empty();
+}
+
+// Decides whether a run of * or _ from start to end can open or close emphasis, see
+// https://spec.commonmark.org/0.29/#left-flanking-delimiter-run
+static Inline DelimiterRun(const std::string &s, size_t start, size_t end) {
+	char before = start > 0 ? s[start - 1] : ' ';
+	char after = end < s.length() ? s[end] : ' ';
+
+	bool left = !IsSpace(after) && (!IsPunct(after) || IsSpace(before) || IsPunct(before));
+	bool right = !IsSpace(before) && (!IsPunct(before) || IsSpace(after) || IsPunct(after));
+
+	Inline run = { std::string(), s[start], end - start, left, right };
+
+	// Underscores never make emphasis in the middle of a word, e.g. snake_case_name
+	if (run.delimiter == '_') {
+		run.can_open = left && (!right || IsPunct(before));
+		run.can_close = right && (!left || IsPunct(after));
+	}
+
+	return run;
+}
+
+// Pairs up the delimiter runs, whatever is left over is shown as it is
+static void MatchEmphasis(std::vector<Inline> &pieces) {
+	std::vector<size_t> openers;
+
+	for (size_t i = 0; i < pieces.size(); ++i) {
+		Inline &closer = pieces[i];
+		if (closer.delimiter == 0)
+			continue;
+
+		if (closer.can_close) {
+			for (size_t o = openers.size(); o-- > 0 && closer.count > 0;) {
+				Inline &opener = pieces[openers[o]];
+				if (opener.delimiter != closer.delimiter)
+					continue;
+
+				// Python's __init__ and friends are names, not bold text
+				if (closer.delimiter == '_' && opener.count >= 2 && closer.count >= 2 && openers[o] + 2 == i && IsWord(pieces[i - 1].text))
+					break;
+
+				size_t n = opener.count < closer.count ? opener.count : closer.count;
+				opener.count -= n;
+				closer.count -= n;
+
+				// Anything opened in between can no longer be closed
+				openers.resize(opener.count > 0 ? o + 1 : o);
+			}
+		}
+
+		if (closer.count > 0 && closer.can_open)
+			openers.push_back(i);
+	}
+}
+
+// Strips the inline markdown that a calltip cannot show
+static std::string StripInline(const std::string &s) {
+	std::vector<Inline> pieces;
+
+	auto text = [&pieces]() -> std::string & {
+		if (pieces.empty() || pieces.back().delimiter != 0)
+			pieces.push_back({ std::string(), 0, 0, false, false });
+		return pieces.back().text;
+	};
+
+	for (size_t i = 0; i < s.length(); ++i) {
+		char c = s[i];
+
+		if (c == '\\' && i + 1 < s.length() && ispunct((unsigned char)s[i + 1])) {
+			text() += s[++i];
+		}
+		else if (c == '`') {
+			// A code span ends with a run of backticks just as long, its contents are left alone
+			size_t ticks = s.find_first_not_of('`', i);
+			if (ticks == std::string::npos)
+				ticks = s.length();
+			std::string fence = s.substr(i, ticks - i);
+
+			size_t close = ticks;
+			while ((close = s.find(fence, close)) != std::string::npos && close + fence.length() < s.length() && s[close + fence.length()] == '`')
+				close = s.find_first_not_of('`', close);
+
+			if (close == std::string::npos) {
+				text() += fence;
+				i = ticks - 1;
+				continue;
+			}
+
+			std::string code = s.substr(ticks, close - ticks);
+			if (code.length() > 2 && code.front() == ' ' && code.back() == ' ' && code.find_first_not_of(' ') != std::string::npos)
+				code = code.substr(1, code.length() - 2);
+
+			text() += code;
+			i = close + fence.length() - 1;
+		}
+		else if (c == '*' || c == '_') {
+			size_t end = s.find_first_not_of(c, i);
+			if (end == std::string::npos)
+				end = s.length();
+
+			pieces.push_back(DelimiterRun(s, i, end));
+			i = end - 1;
+		}
+		else if (c == '[') {
+			// [text](url) becomes text
+			size_t close = s.find("](", i);
+			size_t end = close == std::string::npos ? std::string::npos : s.find(')', close);
+			if (end != std::string::npos) {
+				text() += StripInline(s.substr(i + 1, close - i - 1));
+				i = end;
+			}
+			else {
+				text() += c;
+			}
+		}
+		else if (c == '&') {
+			static const char *entities[][2] = { { "&nbsp;", " " }, { "&lt;", "<" }, { "&gt;", ">" }, { "&amp;", "&" }, { "&quot;", "\"" } };
+			bool replaced = false;
+			for (const auto &e : entities) {
+				size_t len = strlen(e[0]);
+				if (s.compare(i, len, e[0]) == 0) {
+					text() += e[1];
+					i += len - 1;
+					replaced = true;
+					break;
+				}
+			}
+			if (!replaced)
+				text() += c;
+		}
+		else {
+			text() += c;
+		}
+	}
+
+	MatchEmphasis(pieces);
+
+	std::string out;
+	out.reserve(s.length());
+
+	for (const auto &piece : pieces) {
+		if (piece.delimiter == 0)
+			out += piece.text;
+		else
+			out.append(piece.count, piece.delimiter);
+	}
+
+	return out;
+}
+
+static void Wrap(const std::string &text, std::vector<Line> &lines) {
+	size_t start = 0;
+
+	while (text.length() - start > WRAP_WIDTH) {
+		size_t space = text.rfind(' ', start + WRAP_WIDTH);
+		if (space == std::string::npos || space <= start)
+			break;
+
+		lines.push_back({ text.substr(start, space - start), false });
+		start = space + 1;
+	}
+
+	lines.push_back({ text.substr(start), false });
+}
+
+static std::vector<Line> MarkdownToLines(const std::string &markdown) {
+	std::vector<Line> lines;
+	bool in_code = false;
+	size_t start = 0;
+
+	while (start <= markdown.length()) {
+		size_t end = markdown.find('\n', start);
+		if (end == std::string::npos)
+			end = markdown.length();
+
+		std::string line = markdown.substr(start, end - start);
+		start = end + 1;
+
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line.compare(0, 3, "```") == 0) {
+			in_code = !in_code;
+			continue;
+		}
+
+		if (in_code) {
+			lines.push_back({ line, true });
+			continue;
+		}
+
+		// Collapse runs of blank lines
+		if (line.find_first_not_of(" \t") == std::string::npos) {
+			if (!lines.empty() && !lines.back().text.empty())
+				lines.push_back({ std::string(), false });
+			continue;
+		}
+
+		if (line == "---" || line == "***" || line == "___") {
+			lines.push_back({ "----", false });
+			continue;
+		}
+
+		// Headers just become normal text
+		size_t hashes = line.find_first_not_of('#');
+		if (hashes > 0 && hashes != std::string::npos && line[hashes] == ' ')
+			line.erase(0, hashes + 1);
+
+		Wrap(StripInline(line), lines);
+	}
+
+	while (!lines.empty() && lines.back().text.empty())
+		lines.pop_back();
+
+	return lines;
+}
+
+HoverRenderer::HoverRenderer(size_t lines_per_page, size_t capacity) : lines_per_page(lines_per_page), capacity(capacity) {
+}
+
+std::shared_ptr<const RenderedHover> HoverRenderer::Render(const json &contents) {
+	// Keyed on the whole text rather than a hash of it so two hovers can never be mixed up
+	std::string key = contents.dump();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto it = cache.find(key);
+		if (it != cache.end()) {
+			Metrics::Global().Increment("hover.render_cache_hits");
+			lru.splice(lru.begin(), lru, it->second);
+			return it->second->second;
+		}
+	}
+
+	// Two threads may end up converting the same contents, which is harmless
+	auto rendered = Convert(contents);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (cache.find(key) != cache.end())
+		return rendered;
+
+	lru.emplace_front(key, rendered);
+	cache[std::move(key)] = lru.begin();
+
+	if (lru.size() > capacity) {
+		cache.erase(lru.back().first);
+		lru.pop_back();
+	}
+
+	return rendered;
+}
+
+std::shared_ptr<const RenderedHover> HoverRenderer::Convert(const json &contents) const {
+	auto rendered = std::make_shared<RenderedHover>();
+
+	std::string markdown;
+	AppendMarkdown(contents, markdown);
+
+	std::vector<Line> lines = MarkdownToLines(markdown);
+	if (lines.empty())
+		return rendered;
+
+	size_t page_count = (lines.size() + lines_per_page - 1) / lines_per_page;
+
+	for (size_t p = 0; p < page_count; ++p) {
+		RenderedHover::Page page;
+
+		// \001 and \002 are drawn by Scintilla as up and down arrows
+		if (page_count > 1)
+			page.text = "\001\002 " + std::to_string(p + 1) + "/" + std::to_string(page_count) + "\n";
+
+		size_t first = p * lines_per_page;
+		size_t last = first + lines_per_page < lines.size() ? first + lines_per_page : lines.size();
+
+		for (size_t i = first; i < last; ++i) {
+			const Line &line = lines[i];
+
+			if (line.code && page.highlight_start == -1)
+				page.highlight_start = static_cast<int>(page.text.length());
+
+			page.text += line.text;
+
+			// Highlight through the end of the first block of code
+			if (line.code && page.highlight_end <= page.highlight_start && (i + 1 == last || !lines[i + 1].code))
+				page.highlight_end = static_cast<int>(page.text.length());
+
+			if (i + 1 != last)
+				page.text += '\n';
+		}
+
+		rendered->pages.push_back(std::move(page));
+	}
+
+	return rendered;
+}
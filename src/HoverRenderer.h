@@ -0,0 +1,63 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "json.hpp"
+
+using namespace nlohmann;
+
+// Hover contents converted into something a calltip can display
+struct RenderedHover {
+	struct Page {
+		std::string text;
+
+		// The first bit of code on the page, -1 if there is none
+		int highlight_start = -1;
+		int highlight_end = -1;
+	};
+
+	std::vector<Page> pages;
+};
+
+// Turns the many shapes of hover contents (MarkedString, MarkedString[], MarkupContent)
+// into calltip pages. Results are cached by the serialized contents. Safe to use from any thread.
+class HoverRenderer final {
+public:
+	explicit HoverRenderer(size_t lines_per_page = 20, size_t capacity = 128);
+
+	std::shared_ptr<const RenderedHover> Render(const json &contents);
+
+private:
+	typedef std::list<std::pair<std::string, std::shared_ptr<const RenderedHover>>> LruList;
+
+	size_t lines_per_page;
+	size_t capacity;
+	std::mutex mutex;
+	LruList lru;
+	std::unordered_map<std::string, LruList::iterator> cache;
+
+	std::shared_ptr<const RenderedHover> Convert(const json &contents) const;
+};
@@ -0,0 +1,202 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "IdentifierIndex.h"
+#include "Metrics.h"
+
+#include <chrono>
+
+static inline bool IsWordStart(unsigned char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0x80;
+}
+
+static inline bool IsWordChar(unsigned char c) {
+	return IsWordStart(c) || (c >= '0' && c <= '9');
+}
+
+IdentifierIndex::IdentifierIndex(ScintillaGateway &editor) : editor(editor) {
+}
+
+void IdentifierIndex::Activate(uptr_t document) {
+	auto it = documents.find(document);
+	if (it != documents.end()) {
+		current = &it->second;
+		return;
+	}
+
+	current = &documents[document];
+	Rebuild();
+}
+
+void IdentifierIndex::Deactivate() {
+	current = nullptr;
+}
+
+void IdentifierIndex::Remove(uptr_t document) {
+	auto it = documents.find(document);
+	if (it == documents.end())
+		return;
+
+	for (const auto &line : it->second.lines) {
+		for (WordId id : line)
+			Release(id);
+	}
+
+	if (current == &it->second)
+		current = nullptr;
+
+	documents.erase(it);
+}
+
+void IdentifierIndex::Modified(const SCNotification *notifyCode) {
+	if (current == nullptr || !(notifyCode->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+		return;
+
+	// Notifications could have been missed (e.g. coming from the other view) so start over
+	if ((int)current->lines.size() + notifyCode->linesAdded != editor.GetLineCount()) {
+		Rebuild();
+		return;
+	}
+
+	auto &lines = current->lines;
+	int line = editor.LineFromPosition(notifyCode->position);
+
+	// Lines that have not been indexed yet are left for Continue()
+	if (notifyCode->linesAdded > 0) {
+		RemoveLine(line);
+		lines.insert(lines.begin() + line + 1, notifyCode->linesAdded, std::vector<WordId>());
+
+		if (line >= current->indexed)
+			return;
+
+		current->indexed += notifyCode->linesAdded;
+		for (int i = line; i <= line + notifyCode->linesAdded; ++i)
+			AddLine(i);
+	}
+	else {
+		int removed = -notifyCode->linesAdded;
+		for (int i = line; i <= line + removed; ++i)
+			RemoveLine(i);
+
+		lines.erase(lines.begin() + line + 1, lines.begin() + line + 1 + removed);
+
+		if (current->indexed > line + 1)
+			current->indexed = current->indexed - removed > line + 1 ? current->indexed - removed : line + 1;
+
+		if (line < current->indexed)
+			AddLine(line);
+	}
+}
+
+void IdentifierIndex::Continue(unsigned int budget) {
+	if (current == nullptr || current->indexed >= (int)current->lines.size())
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+	auto limit = std::chrono::milliseconds(budget);
+	int first = current->indexed;
+
+	do {
+		AddLine(current->indexed++);
+	} while (current->indexed < (int)current->lines.size() && std::chrono::steady_clock::now() - start < limit);
+
+	Metrics::Global().Increment("identifiers.lines_indexed", current->indexed - first);
+}
+
+std::vector<std::string> IdentifierIndex::Complete(const std::string &prefix, size_t max_results) const {
+	std::vector<std::string> results;
+
+	for (auto it = live.lower_bound(prefix); it != live.end() && results.size() < max_results; ++it) {
+		if (it->compare(0, prefix.length(), prefix) != 0)
+			break;
+
+		// No need to suggest exactly what was already typed
+		if (it->length() > prefix.length())
+			results.push_back(*it);
+	}
+
+	return results;
+}
+
+void IdentifierIndex::Rebuild() {
+	for (const auto &line : current->lines) {
+		for (WordId id : line)
+			Release(id);
+	}
+
+	current->lines.clear();
+	current->lines.resize(editor.GetLineCount());
+	current->indexed = 0;
+}
+
+void IdentifierIndex::AddLine(int line) {
+	std::string text = editor.GetLine(line);
+	auto &words = current->lines[line];
+
+	size_t i = 0;
+	while (i < text.length()) {
+		if (!IsWordStart(text[i])) {
+			// Skip the rest of numbers and such so "0x1F" does not produce "x1F"
+			while (i < text.length() && IsWordChar(text[i]))
+				++i;
+			++i;
+			continue;
+		}
+
+		size_t start = i;
+		while (i < text.length() && IsWordChar(text[i]))
+			++i;
+
+		if (i - start > 1)
+			words.push_back(Intern(text.substr(start, i - start)));
+	}
+}
+
+void IdentifierIndex::RemoveLine(int line) {
+	auto &words = current->lines[line];
+
+	for (WordId id : words)
+		Release(id);
+
+	words.clear();
+}
+
+IdentifierIndex::WordId IdentifierIndex::Intern(const std::string &word) {
+	auto it = ids.find(word);
+	WordId id;
+
+	if (it == ids.end()) {
+		id = static_cast<WordId>(names.size());
+		ids[word] = id;
+		names.push_back(word);
+		counts.push_back(0);
+	}
+	else {
+		id = it->second;
+	}
+
+	if (counts[id]++ == 0)
+		live.insert(names[id]);
+
+	return id;
+}
+
+void IdentifierIndex::Release(WordId id) {
+	if (--counts[id] == 0)
+		live.erase(names[id]);
+}
@@ -0,0 +1,79 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ScintillaGateway.h"
+
+// Keeps track of every identifier in the open documents so simple word
+// completions can be answered without waiting on the server. A document is
+// indexed a few lines at a time with whatever time each frame has left, so
+// showing a huge file does not freeze the editor while it is tokenized.
+class IdentifierIndex final {
+public:
+	explicit IdentifierIndex(ScintillaGateway &editor);
+
+	// The document is now shown in the editor, it is indexed by Continue()
+	void Activate(uptr_t document);
+
+	// The document now shown is not one to index
+	void Deactivate();
+
+	void Remove(uptr_t document);
+
+	// Called for SCN_MODIFIED of the currently active document
+	void Modified(const SCNotification *notifyCode);
+
+	// Called from the UI thread every frame, indexes lines of the current document until
+	// it is done or budget milliseconds have passed
+	void Continue(unsigned int budget);
+
+	// Words starting with the prefix, in sorted order
+	std::vector<std::string> Complete(const std::string &prefix, size_t max_results) const;
+
+private:
+	typedef unsigned int WordId;
+
+	ScintillaGateway &editor;
+
+	// All the unique words ever seen and how many times they are used
+	std::unordered_map<std::string, WordId> ids;
+	std::vector<std::string> names;
+	std::vector<int> counts;
+	std::set<std::string> live;
+
+	// The words on each line of each document, lines from indexed on have not been read yet
+	struct Document {
+		std::vector<std::vector<WordId>> lines;
+		int indexed = 0;
+	};
+
+	std::unordered_map<uptr_t, Document> documents;
+	Document *current = nullptr;
+
+	void Rebuild();
+	void AddLine(int line);
+	void RemoveLine(int line);
+	WordId Intern(const std::string &word);
+	void Release(WordId id);
+};
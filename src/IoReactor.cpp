@@ -0,0 +1,80 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "IoReactor.h"
+#include "Metrics.h"
+
+// Plenty to parse what a handful of servers send
+static const int pool_size = 2;
+
+IoReactor &IoReactor::Global() {
+	static IoReactor reactor(pool_size);
+	return reactor;
+}
+
+IoReactor::IoReactor(int threads) : thread_count(threads) {
+	port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, threads);
+}
+
+IoReactor::~IoReactor() {
+	// Stopped on NPPN_SHUTDOWN
+	for (auto &thread : threads)
+		thread.detach();
+
+	CloseHandle(port);
+}
+
+bool IoReactor::Attach(HANDLE handle) {
+	if (threads.empty()) {
+		for (int i = 0; i < thread_count; ++i)
+			threads.emplace_back(&IoReactor::Run, this);
+
+		Metrics::Global().Set("io.threads", thread_count);
+	}
+
+	return CreateIoCompletionPort(handle, port, 0, 0) != NULL;
+}
+
+void IoReactor::Post(Operation *operation) {
+	PostQueuedCompletionStatus(port, 0, 0, &operation->overlapped);
+}
+
+void IoReactor::Stop() {
+	// A packet without an operation tells a thread to quit
+	for (size_t i = 0; i < threads.size(); ++i)
+		PostQueuedCompletionStatus(port, 0, 0, NULL);
+
+	for (auto &thread : threads)
+		thread.join();
+
+	threads.clear();
+}
+
+void IoReactor::Run() {
+	for (;;) {
+		DWORD bytes = 0;
+		ULONG_PTR key = 0;
+		LPOVERLAPPED overlapped = NULL;
+
+		BOOL success = GetQueuedCompletionStatus(port, &bytes, &key, &overlapped, INFINITE);
+		if (overlapped == NULL)
+			return;
+
+		static_cast<Operation::Overlapped *>(overlapped)->operation->Complete(bytes, success ? 0 : GetLastError());
+	}
+}
@@ -0,0 +1,69 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <windows.h>
+
+#include <thread>
+#include <vector>
+
+// Waits on the pipes of every server through a single I/O completion port, so the
+// number of threads stays the same no matter how many servers are running. Whatever
+// completes is handled on one of a small pool of threads that all wait on the port.
+class IoReactor final {
+public:
+	// Something started with the OVERLAPPED in it, or posted to the reactor
+	struct Operation {
+		struct Overlapped : OVERLAPPED {
+			Operation *operation;
+		} overlapped;
+
+		Operation() {
+			ZeroMemory(&overlapped, sizeof(overlapped));
+			overlapped.operation = this;
+		}
+		virtual ~Operation() {}
+
+		// Called on one of the pool's threads, error is 0 if it succeeded
+		virtual void Complete(DWORD bytes, DWORD error) = 0;
+	};
+
+	static IoReactor &Global();
+
+	explicit IoReactor(int threads);
+	~IoReactor();
+
+	// The handle has to be opened for overlapped I/O. The threads are started the first time.
+	bool Attach(HANDLE handle);
+
+	// Runs the operation on the pool
+	void Post(Operation *operation);
+
+	// Waits for the threads to finish, nothing attached will complete after this
+	void Stop();
+
+	bool IsRunning() const { return !threads.empty(); }
+
+private:
+	HANDLE port;
+	int thread_count;
+	std::vector<std::thread> threads;
+
+	void Run();
+};
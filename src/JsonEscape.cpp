@@ -0,0 +1,224 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "JsonEscape.h"
+#include "Cpu.h"
+
+#include <cstring>
+
+#ifdef CPU_SSE2
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+// How long each byte becomes, anything else below 0x20 is written as \u00XX
+static inline size_t EscapedSize(unsigned char c) {
+	if (c == '"' || c == '\\')
+		return 2;
+	if (c >= 0x20)
+		return 1;
+	if (c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t')
+		return 2;
+	return 6;
+}
+
+static inline bool NeedsEscape(unsigned char c) {
+	return c < 0x20 || c == '"' || c == '\\';
+}
+
+static inline char *EscapeByte(unsigned char c, char *out) {
+	static const char hex[] = "0123456789abcdef";
+
+	switch (c) {
+		case '"': *out++ = '\\'; *out++ = '"'; break;
+		case '\\': *out++ = '\\'; *out++ = '\\'; break;
+		case '\b': *out++ = '\\'; *out++ = 'b'; break;
+		case '\f': *out++ = '\\'; *out++ = 'f'; break;
+		case '\n': *out++ = '\\'; *out++ = 'n'; break;
+		case '\r': *out++ = '\\'; *out++ = 'r'; break;
+		case '\t': *out++ = '\\'; *out++ = 't'; break;
+		default:
+			if (c < 0x20) {
+				*out++ = '\\';
+				*out++ = 'u';
+				*out++ = '0';
+				*out++ = '0';
+				*out++ = hex[c >> 4];
+				*out++ = hex[c & 0xF];
+			}
+			else {
+				*out++ = static_cast<char>(c);
+			}
+			break;
+	}
+
+	return out;
+}
+
+static size_t EscapedLengthScalar(const char *text, size_t length) {
+	size_t escaped = length;
+
+	for (size_t i = 0; i < length; ++i) {
+		unsigned char c = static_cast<unsigned char>(text[i]);
+		if (NeedsEscape(c))
+			escaped += EscapedSize(c) - 1;
+	}
+
+	return escaped;
+}
+
+static char *EscapeScalar(const char *text, size_t length, char *out) {
+	for (size_t i = 0; i < length; ++i)
+		out = EscapeByte(static_cast<unsigned char>(text[i]), out);
+
+	return out;
+}
+
+#ifdef CPU_SSE2
+
+static inline unsigned int LowestBit(unsigned int mask) {
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+}
+
+// A bit for every byte of the block that has to be escaped
+static inline unsigned int EscapeMask(__m128i bytes) {
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i last_control = _mm_set1_epi8(0x1F);
+
+	// Unsigned compare: the byte is a control character if it is its own minimum with 0x1F
+	__m128i control = _mm_cmpeq_epi8(_mm_min_epu8(bytes, last_control), bytes);
+	__m128i special = _mm_or_si128(_mm_cmpeq_epi8(bytes, quote), _mm_cmpeq_epi8(bytes, backslash));
+
+	return static_cast<unsigned int>(_mm_movemask_epi8(_mm_or_si128(control, special)));
+}
+
+static inline unsigned int EscapeMask(__m256i bytes) {
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i last_control = _mm256_set1_epi8(0x1F);
+
+	__m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, last_control), bytes);
+	__m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, quote), _mm256_cmpeq_epi8(bytes, backslash));
+
+	return static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_or_si256(control, special)));
+}
+
+static size_t EscapedLengthSse2(const char *text, size_t length) {
+	size_t escaped = length;
+	size_t i = 0;
+
+	for (; i + 16 <= length; i += 16) {
+		unsigned int mask = EscapeMask(_mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i)));
+
+		for (; mask != 0; mask &= mask - 1)
+			escaped += EscapedSize(static_cast<unsigned char>(text[i + LowestBit(mask)])) - 1;
+	}
+
+	return escaped + EscapedLengthScalar(text + i, length - i) - (length - i);
+}
+
+static size_t EscapedLengthAvx2(const char *text, size_t length) {
+	size_t escaped = length;
+	size_t i = 0;
+
+	for (; i + 32 <= length; i += 32) {
+		unsigned int mask = EscapeMask(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(text + i)));
+
+		for (; mask != 0; mask &= mask - 1)
+			escaped += EscapedSize(static_cast<unsigned char>(text[i + LowestBit(mask)])) - 1;
+	}
+
+	return escaped + EscapedLengthSse2(text + i, length - i) - (length - i);
+}
+
+// Copies the clean bytes of the block and escapes the rest. A block with nothing to
+// escape is written in one store, which is safe since it takes as much room escaped.
+template<size_t N>
+static inline char *EscapeBlock(const char *text, unsigned int mask, char *out) {
+	size_t copied = 0;
+
+	for (; mask != 0; mask &= mask - 1) {
+		size_t special = LowestBit(mask);
+
+		memcpy(out, text + copied, special - copied);
+		out = EscapeByte(static_cast<unsigned char>(text[special]), out + (special - copied));
+		copied = special + 1;
+	}
+
+	memcpy(out, text + copied, N - copied);
+	return out + (N - copied);
+}
+
+static char *EscapeSse2(const char *text, size_t length, char *out) {
+	size_t i = 0;
+
+	for (; i + 16 <= length; i += 16) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+		unsigned int mask = EscapeMask(bytes);
+
+		if (mask == 0) {
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out), bytes);
+			out += 16;
+		}
+		else {
+			out = EscapeBlock<16>(text + i, mask, out);
+		}
+	}
+
+	return EscapeScalar(text + i, length - i, out);
+}
+
+static char *EscapeAvx2(const char *text, size_t length, char *out) {
+	size_t i = 0;
+
+	for (; i + 32 <= length; i += 32) {
+		__m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(text + i));
+		unsigned int mask = EscapeMask(bytes);
+
+		if (mask == 0) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(out), bytes);
+			out += 32;
+		}
+		else {
+			out = EscapeBlock<32>(text + i, mask, out);
+		}
+	}
+
+	return EscapeSse2(text + i, length - i, out);
+}
+
+#endif
+
+size_t JsonEscapedLength(const char *text, size_t length) {
+#ifdef CPU_SSE2
+	return CpuHasAvx2() ? EscapedLengthAvx2(text, length) : EscapedLengthSse2(text, length);
+#else
+	return EscapedLengthScalar(text, length);
+#endif
+}
+
+char *JsonEscape(const char *text, size_t length, char *out) {
+#ifdef CPU_SSE2
+	return CpuHasAvx2() ? EscapeAvx2(text, length, out) : EscapeSse2(text, length, out);
+#else
+	return EscapeScalar(text, length, out);
+#endif
+}
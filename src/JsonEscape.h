@@ -0,0 +1,29 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <cstddef>
+
+// Length of the text once it is escaped to go inside a JSON string
+size_t JsonEscapedLength(const char *text, size_t length);
+
+// Escapes the text to go inside a JSON string. The output needs room for
+// JsonEscapedLength() bytes, or 6 bytes for every input byte. Returns the end
+// of what was written.
+char *JsonEscape(const char *text, size_t length, char *out);
@@ -17,6 +17,8 @@
 // Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 
 #include "LspClient.h"
+#include "Metrics.h"
+#include "JsonEscape.h"
 
 #include <string>
 #include <windows.h>
@@ -44,62 +46,359 @@ enum CompletionItemKind {
 	Reference = 18
 };
 
+// Requests the user is sitting there waiting on
+static const char *interactive_methods[] = {
+	"textDocument/completion",
+	"completionItem/resolve",
+	"textDocument/hover",
+	"textDocument/definition",
+	"textDocument/signatureHelp",
+	"$/cancelRequest",
+};
+
+// Nobody is waiting on these
+static const char *background_methods[] = {
+	"textDocument/diagnostic",
+	"workspace/diagnostic",
+};
+
+// Only worth anything if they come back quickly, so they are not sent at all when the server is behind
+static const char *droppable_methods[] = {
+	"textDocument/hover",
+	"textDocument/documentHighlight",
+	"completionItem/resolve",
+};
+
+// Have no side effects, so identical ones can share a response
+static const char *deduplicated_methods[] = {
+	"textDocument/completion",
+	"completionItem/resolve",
+	"textDocument/hover",
+	"textDocument/definition",
+	"textDocument/signatureHelp",
+	"textDocument/documentHighlight",
+};
 
-LspClient::LspClient(ScintillaGateway &editor) : editor(editor) {
+// Have to reach the server in the order they were sent relative to everything else
+static const char *sync_methods[] = {
+	"initialize",
+	"initialized",
+	"shutdown",
+	"exit",
+	"textDocument/didOpen",
+	"textDocument/didChange",
+	"textDocument/didSave",
+	"textDocument/didClose",
+};
+
+// Milliseconds, anything can be changed with the [Timeouts] section of the ini
+static std::unordered_map<std::string, DWORD> timeouts = {
+	{ "default", 10000 },
+	{ "initialize", 30000 },
+	{ "shutdown", 3000 },
+	{ "textDocument/completion", 5000 },
+	{ "completionItem/resolve", 3000 },
+	{ "textDocument/hover", 3000 },
+	{ "textDocument/definition", 5000 },
+	{ "workspace/diagnostic", 30000 },
+};
+
+// How often waiting on a response checks for requests that have expired
+static const DWORD deadline_resolution = 10;
+
+// Clients are only ever created on the UI thread
+static unsigned int next_serial = 0;
+
+static DWORD TimeoutOf(const std::string &method) {
+	auto it = timeouts.find(method);
+	return it != timeouts.end() ? it->second : timeouts["default"];
+}
+
+static MessageOutbox::Priority PriorityOf(const json &j) {
+	auto method = j.find("method");
+	if (method == j.end() || !method->is_string())
+		return MessageOutbox::Normal;
+
+	const std::string &name = method->get_ref<const std::string &>();
+	for (const char *m : sync_methods)
+		if (name == m)
+			return MessageOutbox::Sync;
+	for (const char *m : interactive_methods)
+		if (name == m)
+			return MessageOutbox::Interactive;
+	for (const char *m : background_methods)
+		if (name == m)
+			return MessageOutbox::Background;
+
+	return MessageOutbox::Normal;
+}
+
+LspClient::LspClient(ScintillaGateway &editor, PositionIndex &positions, const std::string &uri) : editor(editor), positions(positions), uri(uri), serial(++next_serial), deadlines(GetTickCount(), deadline_resolution) {
 	log_file = CreateFile(L"C:\\lsp.log", GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
 
 	CreatePipes();
 	CreateChildProcess();
 
+	channel.reset(new PipeChannel(IoReactor::Global(), g_hChildStd_IN_Wr, g_hChildStd_OUT_Rd, outbox, [this](const char *data, size_t length) {
+		received(data, length);
+	}));
+	channel->Start();
+
 	capabilities = requestInitialize();
+
+	// Initialize timed out or failed, carry on as if the server supports nothing
+	if (!capabilities.is_object())
+		capabilities = json::object();
+	if (!capabilities["capabilities"].is_object())
+		capabilities["capabilities"] = json::object();
+
+	auto completionProvider = capabilities["capabilities"].find("completionProvider");
+	if (completionProvider != capabilities["capabilities"].end() && completionProvider->find("triggerCharacters") != completionProvider->end()) {
+		for (const auto &trigger : (*completionProvider)["triggerCharacters"]) {
+			if (trigger.is_string())
+				completion_triggers += trigger.get<std::string>();
+		}
+	}
+
+	// Without this the server counts in UTF-16
+	auto positionEncoding = capabilities["capabilities"].find("positionEncoding");
+	if (positionEncoding != capabilities["capabilities"].end() && *positionEncoding == "utf-8") {
+		encoding = PositionIndex::Utf8;
+		Metrics::Global().Increment("client.position_encoding.utf8");
+	}
+	else {
+		Metrics::Global().Increment("client.position_encoding.utf16");
+	}
+
+	auto diagnosticProvider = capabilities["capabilities"].find("diagnosticProvider");
+	if (diagnosticProvider != capabilities["capabilities"].end() && diagnosticProvider->is_object()) {
+		pull_diagnostics = true;
+		workspace_diagnostics = diagnosticProvider->value("workspaceDiagnostics", false);
+	}
 }
 
 LspClient::~LspClient() {
+	// Give the reactor a moment to get out whatever is left (e.g. "exit") before giving up on it
+	channel->Drain(1000);
+	channel.reset();
+
 	if (log_file) {
 		CloseHandle(log_file);
 	}
 
-	CloseHandle(g_hChildStd_IN_Rd);
 	CloseHandle(g_hChildStd_IN_Wr);
 	CloseHandle(g_hChildStd_OUT_Rd);
-	CloseHandle(g_hChildStd_OUT_Wr);
 }
 
-json LspClient::read() {
-	DWORD dwRead;
-	std::string buffer;
+void LspClient::received(const char *data, size_t length) {
+	// The server closed its end
+	if (length == 0) {
+		inbox.Close();
+		return;
+	}
+
+	inbound.append(data, length);
+
+	json message;
+	while (nextMessage(message))
+		inbox.Push(std::move(message));
+}
+
+void LspClient::setTimeout(const std::string &method, DWORD timeout) {
+	timeouts[method] = timeout;
+}
+
+void LspClient::poll() {
+	for (auto &message : inbox.Take())
+		dispatch(message);
+
+	expire();
+}
 
-	buffer.resize(128);
-	ReadFile(g_hChildStd_OUT_Rd, (void*)buffer.data(), 128, &dwRead, NULL);
+void LspClient::expire() {
+	if (deadlines.Empty())
+		return;
 
-	// Find the lenght .e.g "Content-Length: XXX\r\n"
-	int length = std::stoi(buffer.substr(buffer.find_first_of("123456789")));
+	std::vector<int> expired;
+	deadlines.Advance(GetTickCount(), expired);
 
-	// Skip all the headers since they end with two new lines
-	size_t start = buffer.find("\r\n\r\n") + 4;
+	for (int request_id : expired) {
+		// Most have been answered or cancelled long ago
+		auto it = pending.find(request_id);
+		if (it == pending.end())
+			continue;
 
-	// For sanity erase everything up until the start of the json
-	buffer.erase(0, start);
+		Metrics::Global().Increment("timeouts");
+		Metrics::Global().Increment("timeouts." + it->second.method);
 
-	// Probably need to grab more
-	if (buffer.length() < (size_t)length) {
-		// Resize it enough to fit the rest of the data
-		buffer.resize(length);
+		notify("$/cancelRequest", json({ { "id", request_id } }));
 
-		ReadFile(g_hChildStd_OUT_Rd, (void*)&buffer[dwRead - start], length - (dwRead - start), &dwRead, NULL);
+		// Same as if the server had responded with an error
+		respond(request_id, json());
 	}
+}
 
-	json result = json::parse(buffer);
+bool LspClient::nextMessage(json &message) {
+	// Runs on a reactor thread, so nothing the server sends is allowed to throw out of here
+	for (;;) {
+		// Headers end with two new lines
+		size_t headers_end = inbound.find("\r\n\r\n");
+		if (headers_end == std::string::npos)
+			return false;
+
+		// Find the length .e.g "Content-Length: XXX\r\n"
+		size_t length_start = inbound.find("Content-Length: ");
+		if (length_start == std::string::npos || length_start > headers_end) {
+			// Not something we understand, throw the headers away and carry on with the rest
+			inbound.erase(0, headers_end + 4);
+			continue;
+		}
 
-	log(result);
+		size_t length;
+		try {
+			length = std::stoul(inbound.substr(length_start + 16, headers_end - length_start - 16));
+		}
+		catch (const std::exception &) {
+			Metrics::Global().Increment("inbound.malformed");
+			log("Dropped headers with a bad Content-Length:\r\n" + inbound.substr(0, headers_end));
+			inbound.erase(0, headers_end + 4);
+			continue;
+		}
 
-	return result;
+		size_t start = headers_end + 4;
+
+		// Probably need to grab more
+		if (inbound.length() < start + length)
+			return false;
+
+		try {
+			message = json::parse(inbound.begin() + start, inbound.begin() + start + length);
+		}
+		catch (const json::exception &e) {
+			Metrics::Global().Increment("inbound.malformed");
+			log(std::string("Dropped a message that is not valid JSON: ") + e.what() + "\r\n" + inbound.substr(start, length));
+			inbound.erase(0, start + length);
+			continue;
+		}
+
+		inbound.erase(0, start + length);
+
+		return true;
+	}
+}
+
+void LspClient::dispatch(json &message) {
+	// Logged here rather than as it is read so the reactor threads never wait on the file
+	log(message);
+
+	auto method = message.find("method");
+	auto id = message.find("id");
+
+	if (id == message.end()) {
+		// Neither a request, a response nor a notification
+		if (method == message.end() || !method->is_string())
+			return;
+
+		auto params = message.find("params");
+		Metrics::Global().Increment("notifications.applied");
+		handleNotification(*method, params != message.end() ? std::move(*params) : json::object());
+		return;
+	}
+
+	// Requests coming from the server, none of which are supported yet. They still have
+	// to be answered, some servers wait on e.g. window/workDoneProgress/create
+	if (method != message.end()) {
+		if (method->is_string())
+			rejectRequest(*id, *method);
+		return;
+	}
+
+	if (!id->is_number_integer())
+		return;
+
+	auto result = message.find("result");
+	respond(id->get<int>(), result != message.end() ? *result : json());
+}
+
+void LspClient::rejectRequest(const json &server_id, const std::string &method) {
+	Metrics::Global().Increment("server_requests.unsupported");
+	Metrics::Global().Increment("server_requests.unsupported." + method);
+
+	json j = {
+		{ "jsonrpc", "2.0" },
+		{ "id", server_id },
+		{ "error", {
+			{ "code", -32601 }, // MethodNotFound
+			{ "message", "Unsupported method: " + method }
+		} }
+	};
+
+	send(j);
+}
+
+void LspClient::respond(int server_id, const json &result) {
+	// Responses to requests that have been cancelled are dropped
+	auto it = pending.find(server_id);
+	if (it == pending.end())
+		return;
+
+	// Done with before the handlers run since they may well make the same request again
+	PendingRequest request = std::move(it->second);
+	pending.erase(it);
+	in_flight.erase(request.key);
+
+	for (const auto &handler : request.handlers)
+		requests.erase(handler.first);
+
+	for (const auto &handler : request.handlers)
+		handler.second(result);
 }
 
 json LspClient::request(const std::string &method, const json &params) {
+	json result;
+
+	int request_id = request(method, params, [&](const json &r) {
+		result = r;
+	});
+
+	wait(request_id);
+
+	return result;
+}
+
+int LspClient::request(const std::string &method, const json &params, ResponseHandler handler) {
+	if (isSaturated()) {
+		Metrics::Global().Increment("flow.saturated");
+
+		for (const char *m : droppable_methods) {
+			if (method == m) {
+				Metrics::Global().Increment("flow.shed");
+				return -1;
+			}
+		}
+	}
+
 	int request_id = this->id;
 	this->id++;
 
+	// The same question about the same version of the document gets the same answer
+	std::string key;
+	for (const char *m : deduplicated_methods) {
+		if (method == m) {
+			key = method + '\n' + uri + '\n' + std::to_string(version) + '\n' + params.dump();
+			break;
+		}
+	}
+
+	auto existing = key.empty() ? in_flight.end() : in_flight.find(key);
+	if (existing != in_flight.end()) {
+		Metrics::Global().Increment("requests.deduplicated");
+
+		pending[existing->second].handlers.emplace_back(request_id, handler);
+		requests[request_id] = existing->second;
+		return request_id;
+	}
+
 	json j = {
 		{ "jsonrpc", "2.0" },
 		{ "id", request_id },
@@ -107,32 +406,19 @@ json LspClient::request(const std::string &method, const json &params) {
 		{ "params", params }
 	};
 
-	std::string s = j.dump();
-	std::string message = "Content-Length: ";
-	message += std::to_string(s.length());
-	message += "\r\n\r\n";
-	message += s;
+	PendingRequest &request = pending[request_id];
+	request.method = method;
+	request.key = key;
+	request.handlers.emplace_back(request_id, handler);
+	requests[request_id] = request_id;
+	if (!key.empty())
+		in_flight[key] = request_id;
 
-	log(j);
+	deadlines.Schedule(request_id, GetTickCount(), TimeoutOf(method));
 
-	DWORD at;
-	WriteFile(g_hChildStd_IN_Wr, message.c_str(), message.length(), &at, NULL);
-
-	// Read incoming JSON messages until the proper response is found.
-	do {
-		json message = read();
-		if (message.find("id") == message.end()) {
-			handleNotification(message["method"], message["params"]);
-		}
-		else if (message["id"].get<int>() == request_id) {
-			return message["result"];
-		}
-		else {
-			int i = message["id"].get<int>();
-		}
-	} while (true);
+	send(j);
 
-	return json::object({});
+	return request_id;
 }
 
 void LspClient::notify(const std::string &method, const json &params) {
@@ -142,113 +428,199 @@ void LspClient::notify(const std::string &method, const json &params) {
 		{ "params", params }
 	};
 
+	send(j);
+}
+
+void LspClient::cancelRequest(int request_id) {
+	// Nothing to do if it has already been answered
+	auto it = requests.find(request_id);
+	if (it == requests.end())
+		return;
+
+	int server_id = it->second;
+	requests.erase(it);
+
+	auto &request = pending[server_id];
+	for (auto handler = request.handlers.begin(); handler != request.handlers.end(); ++handler) {
+		if (handler->first == request_id) {
+			request.handlers.erase(handler);
+			break;
+		}
+	}
+
+	// Someone else still wants the answer
+	if (!request.handlers.empty())
+		return;
+
+	in_flight.erase(request.key);
+	pending.erase(server_id);
+
+	notify("$/cancelRequest", json({ { "id", server_id } }));
+}
+
+void LspClient::wait(int request_id) {
+	// Handle incoming messages until the proper response is found
+	while (requests.find(request_id) != requests.end()) {
+		// Wakes up regularly so the request expires even if the server never says a thing
+		inbox.Wait(deadline_resolution);
+
+		bool closed = inbox.IsClosed();
+		poll();
+
+		if (closed)
+			break;
+	}
+}
+
+bool LspClient::wait(int request_id, DWORD timeout) {
+	DWORD start = GetTickCount();
+
+	while (requests.find(request_id) != requests.end()) {
+		DWORD elapsed = GetTickCount() - start;
+		if (elapsed >= timeout)
+			break;
+
+		DWORD remaining = timeout - elapsed;
+		inbox.Wait(remaining < deadline_resolution ? remaining : deadline_resolution);
+
+		bool closed = inbox.IsClosed();
+		poll();
+
+		if (closed)
+			break;
+	}
+
+	return requests.find(request_id) == requests.end();
+}
+
+void LspClient::setFlowLimits(size_t max_outstanding, size_t max_queued_bytes) {
+	this->max_outstanding = max_outstanding;
+	this->max_queued_bytes = max_queued_bytes;
+}
+
+bool LspClient::isSaturated() const {
+	return pending.size() >= max_outstanding || outbox.Bytes() >= max_queued_bytes;
+}
+
+bool LspClient::isCompletionTrigger(int ch) const {
+	return ch != 0 && completion_triggers.find((char)ch) != std::string::npos;
+}
+
+void LspClient::send(const json &j) {
+	log(j);
+
+	outbound.Begin();
+	outbound.Append(j);
+	outbound.Finish();
+
+	queue(PriorityOf(j));
+}
+
+void LspClient::sendWithText(const json &j, const std::string &merge_key) {
+	// The document goes where the empty "text" string is
 	std::string s = j.dump();
-	std::string message = "Content-Length: ";
-	message += std::to_string(s.length());
-	message += "\r\n\r\n";
-	message += s;
+	size_t marker = s.find("\"text\":\"\"");
+	if (marker == std::string::npos)
+		return;
 
 	log(j);
 
-	DWORD at;
-	WriteFile(g_hChildStd_IN_Wr, message.c_str(), message.length(), &at, NULL);
+	outbound.Begin();
+	outbound.Append(s.c_str(), marker + 8);
+
+	// Read both halves of Scintilla's gap buffer in place, asking for a range that
+	// does not cross the gap means it does not have to be moved
+	int length = editor.GetLength();
+	int gap = editor.GetGapPosition();
+	if (gap > length)
+		gap = length;
+
+	const char *parts[] = { editor.GetRangePointer(0, gap), editor.GetRangePointer(gap, length - gap) };
+	size_t sizes[] = { static_cast<size_t>(gap), static_cast<size_t>(length - gap) };
+
+	// Escaped straight into the message
+	for (int i = 0; i < 2; ++i)
+		JsonEscape(parts[i], sizes[i], outbound.Extend(JsonEscapedLength(parts[i], sizes[i])));
+
+	outbound.Append(s.c_str() + marker + 8, s.length() - marker - 8);
+	outbound.Finish();
+
+	queue(MessageOutbox::Sync, merge_key);
+}
+
+void LspClient::queue(MessageOutbox::Priority priority, const std::string &merge_key) {
+	// Small messages are copied so the buffer keeps its capacity, anything bigger (i.e.
+	// a document) is handed over as it is so it never exists twice
+	static const size_t max_copied = 64 * 1024;
+
+	if (outbound.Size() <= max_copied) {
+		outbox.Push(std::string(outbound.Data(), outbound.Size()), 0, priority, merge_key);
+	}
+	else {
+		size_t start;
+		std::string storage = outbound.Release(start);
+		outbox.Push(std::move(storage), start, priority, merge_key);
+	}
+
+	channel->Flush();
 }
 
 
 json LspClient::requestInitialize() {
-	std::string content = R"(
-  {
-    "processId":null,
-    "capabilities":{
-      "textDocument":{
-        "signatureHelp":{
-          "signatureInformation":{
-            "documentationFormat":[
-              "plaintext"
-            ]
-          }
-        },
-        "hover":{
-          "contentFormat":[
-            "plaintext"
-          ]
-        },
-        "documentSymbol":{
-          "symbolKind":{
-            "valueSet":[
-              1,
-              2,
-              3,
-              4,
-              5,
-              6,
-              7,
-              8,
-              9,
-              10,
-              11,
-              12,
-              13,
-              14,
-              15,
-              16,
-              17,
-              18,
-              19,
-              20,
-              21,
-              22,
-              23,
-              24,
-              25,
-              26
-            ]
-          }
-        },
-        "completion":{
-          "completionItem":{
-            "preselectSupport":true,
-            "documentationFormat":[
-              "plaintext"
-            ]
-          },
-          "completionItemKind":{
-            "valueSet":[
-              1,
-              2,
-              3,
-              4,
-              5,
-              6,
-              7,
-              8,
-              9,
-              10,
-              11,
-              12,
-              13,
-              14,
-              15,
-              16,
-              17,
-              18,
-              19,
-              20,
-              21,
-              22,
-              23,
-              24,
-              25
-            ]
-          }
-        }
-      }
-    },
-    "rootUri":"file:///Users/Justin/Desktop"
-  }
-)";
-
-	return request("initialize", json::parse(content));
+	json symbol_kinds = json::array();
+	for (int kind = 1; kind <= 26; ++kind)
+		symbol_kinds.push_back(kind);
+
+	json completion_kinds = json::array();
+	for (int kind = 1; kind <= 25; ++kind)
+		completion_kinds.push_back(kind);
+
+	json capabilities = {
+		{ "general",{
+			// Scintilla positions are UTF-8 offsets so the server is asked to use those if it can
+			{ "positionEncodings", { "utf-8", "utf-16" } }
+		} },
+		{ "textDocument",{
+			{ "signatureHelp",{
+				{ "signatureInformation",{
+					{ "documentationFormat", json::array({ "plaintext" }) }
+				} }
+			} },
+			{ "hover",{
+				{ "contentFormat", { "markdown", "plaintext" } }
+			} },
+			{ "documentSymbol",{
+				{ "symbolKind",{
+					{ "valueSet", symbol_kinds }
+				} }
+			} },
+			{ "diagnostic",{
+				{ "dynamicRegistration", false },
+				{ "relatedDocumentSupport", false }
+			} },
+			{ "completion",{
+				{ "completionItem",{
+					{ "preselectSupport", true },
+					{ "documentationFormat", json::array({ "plaintext" }) },
+					{ "resolveSupport",{
+						{ "properties", { "detail", "documentation" } }
+					} }
+				} },
+				{ "completionItemKind",{
+					{ "valueSet", completion_kinds }
+				} }
+			} }
+		} }
+	};
+
+	json params = {
+		{ "processId", nullptr },
+		{ "capabilities", capabilities },
+		// Use the directory the file is in
+		{ "rootUri", uri.substr(0, uri.rfind('/')) }
+	};
+
+	return request("initialize", params);
 }
 
 json LspClient::requestShutdown() {
@@ -262,26 +634,38 @@ void LspClient::notifyExit() {
 
 
 void LspClient::notifyDidChange() {
-	static int i = 0;
+	// No need to send the whole document again if nothing changed
+	if (!dirty || !shown)
+		return;
 
-	notify("textDocument/didChange", json({
-		{ "textDocument",{
-			{ "uri", "file:///Users/Justin/Desktop/lsp.py" },
-			{ "version", ++i } // TODO: incrementing version number?
-		} },
-		{ "contentChanges", {
-			{{"text", editor.GetText().c_str()}},
+	dirty = false;
+
+	sendWithText(json({
+		{ "jsonrpc", "2.0" },
+		{ "method", "textDocument/didChange" },
+		{ "params",{
+			{ "textDocument",{
+				{ "uri", uri },
+				{ "version", ++version }
+			} },
+			{ "contentChanges", json::array({
+				{ { "text", "" } }
+			}) }
 		} }
-	}));
+	}), "textDocument/didChange " + uri); // The whole text is sent so an older change still waiting can just be replaced
 }
 
 void LspClient::notifyDidOpen() {
-	notify("textDocument/didOpen", json({
-		{ "textDocument",{
-			{ "uri", "file:///Users/Justin/Desktop/lsp.py" },
-			{ "languageId", "python" },
-			{ "version", 0 },
-			{ "text", editor.GetText().c_str() }
+	sendWithText(json({
+		{ "jsonrpc", "2.0" },
+		{ "method", "textDocument/didOpen" },
+		{ "params",{
+			{ "textDocument",{
+				{ "uri", uri },
+				{ "languageId", "python" },
+				{ "version", version },
+				{ "text", "" }
+			} }
 		} }
 	}));
 }
@@ -291,38 +675,46 @@ void LspClient::notifyDidSave() {
 
 	notify("textDocument/didSave", json({
 		{ "textDocument",{
-			{ "uri", "file:///Users/Justin/Desktop/lsp.py" }
+			{ "uri", uri }
 		} }
 	}));
 }
 
-json LspClient::requestCompletion(int line, int character) {
+json LspClient::requestCompletion(int position) {
 	notifyDidChange();
 
 	return request("textDocument/completion", json({
 		{ "textDocument",{
-			{ "uri", "file:///Users/Justin/Desktop/lsp.py" }
+			{ "uri", uri }
 		} },
-		{ "position",{
-			{ "line", line },
-			{ "character", character }
-		} }
+		{ "position", positions.ToLsp(position, encoding) }
 	}));
 }
 
-json LspClient::requestHover(int position) {
+int LspClient::requestCompletion(int position, ResponseHandler handler) {
 	notifyDidChange();
 
-	return request("textDocument/hover", json({
+	return request("textDocument/completion", json({
 		{ "textDocument",{
-			{ "uri", "file:///Users/Justin/Desktop/lsp.py" }
+			{ "uri", uri }
 		} },
-		{ "position",{
-			{ "line", editor.LineFromPosition(position) },
-			{ "character", editor.GetColumn(position) }
-		} }
-	}));
+		{ "position", positions.ToLsp(position, encoding) }
+	}), handler);
+}
 
+int LspClient::requestCompletionResolve(const json &item, ResponseHandler handler) {
+	return request("completionItem/resolve", item, handler);
+}
+
+int LspClient::requestHover(int position, ResponseHandler handler) {
+	notifyDidChange();
+
+	return request("textDocument/hover", json({
+		{ "textDocument",{
+			{ "uri", uri }
+		} },
+		{ "position", positions.ToLsp(position, encoding) }
+	}), handler);
 }
 
 json LspClient::requestDefinition(int position) {
@@ -330,29 +722,63 @@ json LspClient::requestDefinition(int position) {
 
 	auto locations = request("textDocument/definition", json({
 		{ "textDocument",{
-			{ "uri", "file:///Users/Justin/Desktop/lsp.py" }
+			{ "uri", uri }
 		} },
-		{ "position",{
-			{ "line", editor.LineFromPosition(position) },
-			{ "character", editor.GetColumn(position) }
-		} }
+		{ "position", positions.ToLsp(position, encoding) }
 	}));
 
-	// TODO: len == 0 or len > 1?
-	return locations[0]["range"];
+	// Either a single Location or an array of them, just the first one is used
+	if (locations.is_array())
+		return locations.empty() ? json() : locations[0].value("range", json());
+	if (locations.is_object())
+		return locations.value("range", json());
+	return json();
 }
 
-void LspClient::handleNotification(const std::string &method, const json &params) {
-	if (method == "textDocument/publishDiagnostics") {
-		return;
-	}
-	else {
-		return;
-	}
+int LspClient::requestDiagnostic(const std::string &previous_result_id, ResponseHandler handler) {
+	notifyDidChange();
+
+	json params = {
+		{ "textDocument",{
+			{ "uri", uri }
+		} }
+	};
+
+	if (!previous_result_id.empty())
+		params["previousResultId"] = previous_result_id;
+
+	return request("textDocument/diagnostic", params, handler);
+}
+
+int LspClient::requestWorkspaceDiagnostic(const json &previous_result_ids, ResponseHandler handler) {
+	notifyDidChange();
+
+	return request("workspace/diagnostic", json({
+		{ "previousResultIds", previous_result_ids }
+	}), handler);
 }
 
+void LspClient::handleNotification(const std::string &method, json &&params) {
+	if (notification_handler)
+		notification_handler(method, std::move(params));
+}
+
+
+// Anonymous pipes can not do overlapped I/O, so our ends are named pipes the reactor can wait on
+static bool CreateOverlappedPipe(const std::wstring &name, DWORD direction, HANDLE &ours, HANDLE &theirs, SECURITY_ATTRIBUTES *inherit) {
+	ours = CreateNamedPipe(name.c_str(), direction | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE, PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 64 * 1024, 64 * 1024, 0, NULL);
+	if (ours == INVALID_HANDLE_VALUE)
+		return false;
+
+	// The child's end is opened like any other file, so it is inherited and stays synchronous
+	DWORD access = direction == PIPE_ACCESS_INBOUND ? GENERIC_WRITE : GENERIC_READ;
+	theirs = CreateFile(name.c_str(), access, 0, inherit, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	return theirs != INVALID_HANDLE_VALUE;
+}
 
 void LspClient::CreatePipes() {
+	static int pipes_created = 0;
 	SECURITY_ATTRIBUTES saAttr;
 
 	// Set the bInheritHandle flag so pipe handles are inherited.
@@ -360,21 +786,15 @@ void LspClient::CreatePipes() {
 	saAttr.bInheritHandle = TRUE;
 	saAttr.lpSecurityDescriptor = NULL;
 
-	// Create a pipe for the child process's STDOUT
-	if (!CreatePipe(&g_hChildStd_OUT_Rd, &g_hChildStd_OUT_Wr, &saAttr, 0))
-		MessageBox(NULL, L"StdoutRd CreatePipe", L"Oh Noes", MB_OK);
-
-	// Ensure the read handle to the pipe for STDOUT is not inherited
-	if (!SetHandleInformation(g_hChildStd_OUT_Rd, HANDLE_FLAG_INHERIT, 0))
-		MessageBox(NULL, L"Stdout SetHandleInformation", L"Oh Noes", MB_OK);
+	std::wstring name = L"\\\\.\\pipe\\NppLsp." + std::to_wstring(GetCurrentProcessId()) + L"." + std::to_wstring(pipes_created++);
 
-	// Create a pipe for the child process's STDIN. 
-	if (!CreatePipe(&g_hChildStd_IN_Rd, &g_hChildStd_IN_Wr, &saAttr, 0))
-		MessageBox(NULL, L"Stdin CreatePipe", L"Oh Noes", MB_OK);
+	// Create a pipe for the child process's STDOUT, only the child's end is inherited
+	if (!CreateOverlappedPipe(name + L".out", PIPE_ACCESS_INBOUND, g_hChildStd_OUT_Rd, g_hChildStd_OUT_Wr, &saAttr))
+		MessageBox(NULL, L"Stdout CreateNamedPipe", L"Oh Noes", MB_OK);
 
-	// Ensure the write handle to the pipe for STDIN is not inherited. 
-	if (!SetHandleInformation(g_hChildStd_IN_Wr, HANDLE_FLAG_INHERIT, 0))
-		MessageBox(NULL, L"Stdin SetHandleInformation", L"Oh Noes", MB_OK);
+	// Create a pipe for the child process's STDIN
+	if (!CreateOverlappedPipe(name + L".in", PIPE_ACCESS_OUTBOUND, g_hChildStd_IN_Wr, g_hChildStd_IN_Rd, &saAttr))
+		MessageBox(NULL, L"Stdin CreateNamedPipe", L"Oh Noes", MB_OK);
 }
 
 void LspClient::CreateChildProcess() {
@@ -423,12 +843,21 @@ void LspClient::CreateChildProcess() {
 		CloseHandle(piProcInfo.hProcess);
 		CloseHandle(piProcInfo.hThread);
 	}
+
+	// The child has its own copies now. Holding on to these would keep the pipes open
+	// after the server dies, so the read would never see ERROR_BROKEN_PIPE
+	CloseHandle(g_hChildStd_OUT_Wr);
+	CloseHandle(g_hChildStd_IN_Rd);
+	g_hChildStd_OUT_Wr = NULL;
+	g_hChildStd_IN_Rd = NULL;
 }
 
 void LspClient::log(const std::string &s) {
 	DWORD at;
 
 	if (log_file) {
+		// Parse errors are logged from the reactor threads
+		std::lock_guard<std::mutex> lock(log_mutex);
 		WriteFile(log_file, "---------\r\n", 11, &at, NULL);
 		WriteFile(log_file, s.c_str(), s.length(), &at, NULL);
 		WriteFile(log_file, "\r\n\r\n", 4, &at, NULL);
@@ -441,6 +870,7 @@ void LspClient::log(const json &j) {
 
 	if (log_file) {
 		auto message = j.dump(1, '\t');
+		std::lock_guard<std::mutex> lock(log_mutex);
 		WriteFile(log_file, "---------\r\n\r\n", 13, &at, NULL);
 		WriteFile(log_file, message.c_str(), message.length(), &at, NULL);
 		WriteFile(log_file, "\r\n\r\n", 4, &at, NULL);
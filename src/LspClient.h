@@ -20,20 +20,74 @@
 
 #include <windows.h>
 
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "ScintillaGateway.h"
+#include "MessageInbox.h"
+#include "MessageBuffer.h"
+#include "MessageOutbox.h"
+#include "PipeChannel.h"
+#include "PositionIndex.h"
+#include "TimerWheel.h"
 #include "json.hpp"
 
 using namespace nlohmann;
 
 class LspClient {
 public:
-	LspClient(ScintillaGateway &editor);
+	// Called with the "result" of a response, or null if the server responded with an error
+	typedef std::function<void(const json &result)> ResponseHandler;
+	// The params are handed over so they can be moved on to be processed elsewhere
+	typedef std::function<void(const std::string &method, json &&params)> NotificationHandler;
+
+	LspClient(ScintillaGateway &editor, PositionIndex &positions, const std::string &uri);
 	~LspClient();
 
-	json read();
+	// How long a request may go unanswered before it is cancelled and its handler is given
+	// null, the "default" method applies to anything not set otherwise. Shared by all clients.
+	static void setTimeout(const std::string &method, DWORD timeout);
+
+	// Handles everything the reactor has received so far
+	void poll();
 
 	json request(const std::string &method, const json &params = json::object());
+	int request(const std::string &method, const json &params, ResponseHandler handler);
 	void notify(const std::string &method, const json &params = json::object());
+	void cancelRequest(int request_id);
+	void wait(int request_id);
+	bool wait(int request_id, DWORD timeout);
+
+	bool isCompletionTrigger(int ch) const;
+	bool hasPullDiagnostics() const { return pull_diagnostics; }
+	bool hasWorkspaceDiagnostics() const { return workspace_diagnostics; }
+	PositionIndex::Encoding getPositionEncoding() const { return encoding; }
+
+	// Unique for every client ever created. Work that outlives a client checks this
+	// too, since a new client can be allocated where a closed one used to be.
+	unsigned int getSerial() const { return serial; }
+
+	// Beyond these the server is considered to be falling behind
+	void setFlowLimits(size_t max_outstanding, size_t max_queued_bytes);
+
+	// Too many requests are waiting on an answer, or too much is waiting to be written
+	bool isSaturated() const;
+
+	const std::string &getUri() const { return uri; }
+	void setNotificationHandler(NotificationHandler handler) { notification_handler = handler; }
+
+	// The document has been edited since it was last sent
+	void markDirty() { dirty = true; }
+
+	// The text is only ever read from the editor, so it is only sent while the document
+	// is the one being shown. A dirty document that is not shown is synced once it is.
+	void setShown(bool shown) { this->shown = shown; }
+	bool isDirty() const { return dirty; }
+	int getVersion() const { return version; }
 
 	// https://github.com/Microsoft/language-server-protocol/blob/master/versions/protocol-2-x.md
 
@@ -41,7 +95,6 @@ public:
 	json requestInitialize();
 	json requestShutdown();
 	void notifyExit();
-	// $/cancelRequest
 
 	// Window
 	// window/showMessage
@@ -53,6 +106,7 @@ public:
 	// workspace/didChangeConfiguration
 	// workspace/didChangeWatchedFiles
 	// workspace/symbol
+	int requestWorkspaceDiagnostic(const json &previous_result_ids, ResponseHandler handler);
 
 	// Document
 	// textDocument/publishDiagnostics
@@ -60,9 +114,10 @@ public:
 	// textDocument/didClose
 	void notifyDidOpen();
 	void notifyDidSave();
-	json requestCompletion(int line, int character);
-	// completionItem/resolve
-	json requestHover(int position);
+	json requestCompletion(int position);
+	int requestCompletion(int position, ResponseHandler handler);
+	int requestCompletionResolve(const json &item, ResponseHandler handler);
+	int requestHover(int position, ResponseHandler handler);
 	// textDocument/signatureHelp
 	// textDocument/references
 	// textDocument/documentHighlight
@@ -71,6 +126,7 @@ public:
 	// textDocument/rangeFormatting
 	// textDocument/onTypeFormatting
 	json requestDefinition(int position);
+	int requestDiagnostic(const std::string &previous_result_id, ResponseHandler handler);
 	// textDocument/codeAction
 	// textDocument/codeLens
 	// codeLens/resolve
@@ -81,15 +137,70 @@ public:
 private:
 	int id = 0;
 	HANDLE log_file;
+	std::mutex log_mutex;
 	ScintillaGateway &editor;
+	PositionIndex &positions;
+	std::string uri;
+	NotificationHandler notification_handler;
 	json capabilities;
+	unsigned int serial;
+	int version = 0;
+	bool dirty = false;
+	bool shown = true;
+	std::string completion_triggers;
+	bool pull_diagnostics = false;
+	bool workspace_diagnostics = false;
+	PositionIndex::Encoding encoding = PositionIndex::Utf16;
+	std::string inbound;
+	// A request sent to the server, identical requests made while it is in flight
+	// are given their own id but share its response
+	struct PendingRequest {
+		std::string method;
+		std::string key;
+		std::vector<std::pair<int, ResponseHandler>> handlers;
+	};
+
+	// By the id that was sent to the server
+	std::unordered_map<int, PendingRequest> pending;
+
+	// Ids handed out by request() to the id that was sent to the server
+	std::unordered_map<int, int> requests;
+
+	// Method, uri, version and parameters of pending requests to the id that was sent
+	std::unordered_map<std::string, int> in_flight;
+	TimerWheel deadlines;
+	size_t max_outstanding = 32;
+	size_t max_queued_bytes = 4 * 1024 * 1024;
+
+	// Reused for every message that is sent
+	MessageBuffer outbound;
+
+	// Messages are read and parsed on the reactor's threads and handed over through the inbox
+	MessageInbox inbox;
+
+	// Written by the reactor so the UI never waits on a server that is not keeping up
+	MessageOutbox outbox;
+
+	std::unique_ptr<PipeChannel> channel;
 
 	HANDLE g_hChildStd_IN_Rd;
 	HANDLE g_hChildStd_IN_Wr;
 	HANDLE g_hChildStd_OUT_Rd;
 	HANDLE g_hChildStd_OUT_Wr;
 
-	void handleNotification(const std::string &method, const json &params);
+	void send(const json &j);
+
+	// Sends the message with the text of the document in place of its empty "text" field.
+	// If a message with the same merge key has not been written yet it is replaced.
+	void sendWithText(const json &j, const std::string &merge_key = std::string());
+	void queue(MessageOutbox::Priority priority, const std::string &merge_key = std::string());
+	void received(const char *data, size_t length);
+	bool nextMessage(json &message);
+	void dispatch(json &message);
+	void respond(int server_id, const json &result);
+	void rejectRequest(const json &server_id, const std::string &method);
+	void expire();
+	void handleNotification(const std::string &method, json &&params);
 
 	void CreatePipes();
 	void CreateChildProcess();
@@ -23,10 +23,27 @@
 #include "NppGateway.h"
 
 #include "LspClient.h"
+#include "CompletionResolver.h"
+#include "CompletionPrefetch.h"
+#include "IoReactor.h"
+#include "UiDispatcher.h"
+#include "WorkPool.h"
+#include "Metrics.h"
+#include "StyleFilter.h"
+#include "IdentifierIndex.h"
+#include "CompletionSort.h"
+#include "HoverProvider.h"
+#include "Diagnostics.h"
+#include "ProblemsPanel.h"
+#include "DiagnosticsPuller.h"
+#include "Uri.h"
+#include "PositionIndex.h"
 
 #include <algorithm>
 #include <vector>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <sstream>
 
 
@@ -36,9 +53,33 @@ using namespace nlohmann;
 static HANDLE _hModule;
 static NppGateway npp;
 static ScintillaGateway editor;
+static PositionIndex positions(editor);
+static CompletionResolver resolver(editor);
+static CompletionPrefetch prefetch(editor);
+static StyleFilter style_filter(editor);
+static IdentifierIndex identifiers(editor);
+static HoverProvider hover(editor);
+static DiagnosticsEngine diagnostics(editor, positions);
+static ProblemsPanel problems(npp, diagnostics);
+static void PublishDiagnostics(LspClient *client, const std::string &uri, json items);
+static DiagnosticsPuller puller(PublishDiagnostics);
+static int completion_deadline = 80;
+static size_t max_outstanding = 32;
+static size_t max_queued_bytes = 4 * 1024 * 1024;
+static UINT_PTR poll_timer = 0;
+static unsigned int apply_budget = 4;
+static unsigned int index_budget = 2;
+static bool diagnostics_changed = false;
+
+// Publishes for each uri are numbered so one that finished parsing late can not replace a newer one
+static std::unordered_map<std::string, unsigned int> publish_sequence;
 
 static void GotoDefiniton();
 static void Autocompletion();
+static void NextDiagnostic();
+static void PreviousDiagnostic();
+static void ShowProblems();
+static void ShowStatistics();
 static void ShowAbout();
 
 ShortcutKey sk = { false, false, false, VK_F12 };
@@ -46,7 +87,11 @@ ShortcutKey sk2 = { true, false, false, VK_SPACE };
 static FuncItem funcItem[] = {
 	{ L"Goto Definiton", GotoDefiniton, 0, false, &sk },
 	{ L"Autocompletion", Autocompletion, 0, false, &sk2 },
+	{ L"Next Diagnostic", NextDiagnostic, 0, false, nullptr },
+	{ L"Previous Diagnostic", PreviousDiagnostic, 0, false, nullptr },
+	{ L"Problems", ShowProblems, 0, false, nullptr },
 	{ L"", nullptr, 0, false, nullptr },
+	{ L"Statistics...", ShowStatistics, 0, false, nullptr },
 	{ L"About...", ShowAbout, 0, false, nullptr }
 };
 
@@ -61,15 +106,113 @@ static const wchar_t *GetIniFilePath() {
 	return iniPath;
 }
 
+static void ReadTimeouts() {
+	// Each line is "method=milliseconds", e.g. textDocument/hover=2000
+	wchar_t section[4096];
+	if (GetPrivateProfileSection(L"Timeouts", section, 4096, GetIniFilePath()) == 0)
+		return;
+
+	for (const wchar_t *line = section; *line; line += wcslen(line) + 1) {
+		const wchar_t *equals = wcschr(line, L'=');
+		if (equals == nullptr)
+			continue;
+
+		// Method names are plain ASCII
+		std::string method;
+		for (const wchar_t *c = line; c != equals; ++c)
+			method += static_cast<char>(*c);
+
+		LspClient::setTimeout(method, wcstoul(equals + 1, nullptr, 10));
+	}
+}
 
 std::unordered_map<BufferID, LspClient*> clients;
 LspClient *current_client = nullptr;
 
+// The document shown in the view an editor notification came from
+static BufferID BufferFromScintilla(void *hwnd) {
+	if (hwnd == editor.GetScintillaInstance())
+		return npp.GetCurrentBufferID();
+
+	int view;
+	if (hwnd == npp.data._scintillaMainHandle)
+		view = MAIN_VIEW;
+	else if (hwnd == npp.data._scintillaSecondHandle)
+		view = SUB_VIEW;
+	else
+		return 0;
+
+	return npp.GetBufferIDFromPos(npp.GetCurrentDocIndex(view), view);
+}
+
+static void UpdateStatusBar() {
+	if (current_client == nullptr)
+		return;
+
+	auto counts = diagnostics.Counts();
+	std::wstring status = L"Errors: " + std::to_wstring(counts[1]) + L"  Warnings: " + std::to_wstring(counts[2]);
+	npp.SetStatusBar(STATUSBAR_DOC_TYPE, status);
+}
+
+static void PublishDiagnostics(LspClient *client, const std::string &uri, json items) {
+	PositionIndex::Encoding encoding = client->getPositionEncoding();
+	unsigned int sequence = ++publish_sequence[uri];
+
+	// Parsed and sorted on the pool, only applying them is left for the UI thread
+	WorkPool::Global().Submit([uri, encoding, sequence, items = std::move(items)]() {
+		auto set = std::make_shared<DiagnosticSet>(items);
+
+		UiDispatcher::Global().Post([uri, encoding, sequence, set]() {
+			// A later publish for the same uri was done sooner
+			if (publish_sequence[uri] != sequence) {
+				Metrics::Global().Increment("diagnostics.superseded");
+				return;
+			}
+
+			diagnostics.Publish(uri, std::move(*set), encoding);
+			diagnostics_changed = true;
+		});
+	});
+}
+
+static void HandleNotification(LspClient *client, const std::string &method, json &&params) {
+	if (method == "textDocument/publishDiagnostics") {
+		auto list = params.find("diagnostics");
+		if (list != params.end())
+			PublishDiagnostics(client, params.value("uri", std::string()), std::move(*list));
+	}
+}
+
+static void CALLBACK PollClients(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime) {
+	for (auto &client : clients) {
+		client.second->poll();
+	}
+
+	puller.Tick(current_client);
+
+	// Results from the pool, whatever does not fit in the budget waits for the next frame
+	UiDispatcher::Global().Drain(apply_budget);
+
+	// Everything published during this frame is shown at once
+	if (diagnostics_changed) {
+		diagnostics_changed = false;
+		UpdateStatusBar();
+		problems.Refresh();
+	}
+
+	identifiers.Continue(index_budget);
+}
+
 static void GotoDefiniton() {
+	if (current_client == nullptr)
+		return;
+
 	auto range = current_client->requestDefinition(editor.GetCurrentPos());
+	if (!range.is_object())
+		return;
 
-	int s = editor.PositionFromLine(range["start"]["line"]) + range["start"]["character"];
-	int e = editor.PositionFromLine(range["end"]["line"]) + range["end"]["character"];
+	int s = positions.FromLsp(range["start"], current_client->getPositionEncoding());
+	int e = positions.FromLsp(range["end"], current_client->getPositionEncoding());
 
 	editor.SetSel(s, e);
 }
@@ -135,16 +278,210 @@ std::vector<int> xpm_map = {
 	0, // type parameter
 };
 
+// The list as Scintilla wants it, along with the item each entry came from
+struct PreparedCompletions {
+	std::vector<std::string> autoc;
+	std::vector<json> items;
+};
+
+// Does not touch the editor so it can be done on the pool
+static PreparedCompletions PrepareCompletions(const json &completions, const std::string &typed, const std::vector<std::string> &words) {
+	PreparedCompletions prepared;
+	std::unordered_set<std::string> seen;
+
+	// Either a CompletionList or just an array of CompletionItems
+	auto items = completions.is_object() ? completions.find("items") : completions.end();
+	if (completions.is_array() || (items != completions.end() && items->is_array())) {
+		const json &list = completions.is_array() ? completions : *items;
+
+		for (unsigned int i : SortCompletionItems(list, typed)) {
+			const json &c = list[i];
+			if (!c.is_object())
+				continue;
+
+			auto label = c.find("label");
+			auto insertText = c.find("insertText");
+			if (label == c.end() || !label->is_string())
+				continue;
+			std::string text = insertText != c.end() && insertText->is_string() ? insertText->get<std::string>() : label->get<std::string>();
+
+			// CompletionItemKind starts at 1, anything unknown gets no image
+			auto kind = c.find("kind");
+			int image = 0;
+			if (kind != c.end() && kind->is_number_integer() && kind->get<int>() >= 1 && kind->get<int>() <= static_cast<int>(xpm_map.size()))
+				image = xpm_map[kind->get<int>() - 1];
+
+			prepared.autoc.push_back(text + std::string("?") + std::to_string(image));
+			prepared.items.push_back(c);
+			seen.insert(text);
+		}
+	}
+
+	// Words from the local index that the server did not know about
+	for (const auto &word : words) {
+		if (seen.find(word) == seen.end()) {
+			prepared.autoc.push_back(word);
+			prepared.items.push_back(json());
+		}
+	}
+
+	return prepared;
+}
+
+static std::string TypedSince(int word_start) {
+	int pos = editor.GetCurrentPos();
+	if (pos <= word_start)
+		return std::string();
+
+	return std::string(editor.GetRangePointer(word_start, pos - word_start), pos - word_start);
+}
+
+static void ApplyCompletions(int word_start, PreparedCompletions &&prepared) {
+	std::vector<std::string> &autoc = prepared.autoc;
+	std::vector<json> &items = prepared.items;
+
+	if (autoc.empty())
+		return;
+
+	// Keep the order as given instead of letting Scintilla sort it
+	int order = editor.AutoCGetOrder();
+	editor.AutoCSetOrder(SC_ORDER_CUSTOM);
+	editor.AutoCShow(editor.GetCurrentPos() - word_start, join(autoc, ' '));
+	editor.AutoCSetOrder(order);
+
+	// Documentation is only resolved for the item that is highlighted
+	resolver.Reset(current_client, std::move(items));
+	resolver.Highlight(editor.AutoCGetCurrent());
+}
+
+static void ShowCompletions(int word_start, const json &completions, const std::vector<std::string> &words) {
+	ApplyCompletions(word_start, PrepareCompletions(completions, TypedSince(word_start), words));
+}
+
+static std::vector<std::string> LocalCompletions(int word_start) {
+	int pos = editor.GetCurrentPos();
+	if (pos <= word_start)
+		return std::vector<std::string>();
+
+	std::string prefix(editor.GetRangePointer(word_start, pos - word_start), pos - word_start);
+	return identifiers.Complete(prefix, 100);
+}
+
+// Late results are only shown if the list the user is looking at is still the same one,
+// or, when there was nothing local to show, the caret has not moved since the request
+static bool CanShowLateCompletions(LspClient *client, unsigned int serial, int pos) {
+	if (client != current_client || client->getSerial() != serial)
+		return false;
+
+	if (editor.AutoCActive())
+		return editor.AutoCPosStart() == pos;
+
+	return editor.GetCurrentPos() == pos;
+}
+
 static void Autocompletion() {
-	auto completions = current_client->requestCompletion(editor.LineFromPosition(editor.GetCurrentPos()), editor.GetColumn(editor.GetCurrentPos()));
+	if (current_client == nullptr)
+		return;
 
-	std::vector<std::string> autoc;
-	for (const auto &c : completions["items"]) {
-		auto s = c["insertText"].get<std::string>() + std::string("?") + std::to_string(xpm_map[c["kind"].get<int>()]);
-		autoc.push_back(s);
+	int pos = editor.GetCurrentPos();
+	int word_start = editor.WordStartPosition(pos, true);
+
+	if (!style_filter.ShouldRequest(StyleFilter::Completion, pos, true))
+		return;
+
+	// The results may have already been requested when a trigger character was typed
+	json completions;
+	if (prefetch.Take(current_client, word_start, completions)) {
+		ShowCompletions(word_start, completions, std::vector<std::string>());
+		return;
+	}
+
+	// A prefetch that is still on its way is joined by asking for the same position it did,
+	// the word typed since then is filtered out of the results anyway
+	int request_pos = prefetch.IsPending(current_client, word_start) ? word_start : pos;
+
+	// If the server did not answer in time there are still the words in the document
+	if (completion_deadline <= 0) {
+		completions = current_client->requestCompletion(request_pos);
+		prefetch.Discard();
+		ShowCompletions(word_start, completions, completions.is_null() ? LocalCompletions(word_start) : std::vector<std::string>());
+		return;
 	}
 
-	editor.AutoCShow(0, join(autoc, ' '));
+	// Give the server a little while to answer, if it does not then show what is known locally
+	// and add in the server's results whenever they do show up
+	struct PendingCompletion {
+		bool late = false;
+		json result;
+	};
+	auto state = std::make_shared<PendingCompletion>();
+	LspClient *client = current_client;
+	unsigned int serial = client->getSerial();
+
+	int request_id = client->requestCompletion(request_pos, [state, client, serial, word_start, pos](const json &result) {
+		if (!state->late) {
+			state->result = result;
+			return;
+		}
+
+		if (!CanShowLateCompletions(client, serial, pos))
+			return;
+
+		// Sorted and merged on the pool, the list is still checked again before it is replaced
+		WorkPool::Global().Submit([client, serial, word_start, pos, result, typed = TypedSince(word_start), words = LocalCompletions(word_start)]() {
+			auto prepared = std::make_shared<PreparedCompletions>(PrepareCompletions(result, typed, words));
+
+			UiDispatcher::Global().Post([client, serial, word_start, pos, prepared]() {
+				if (CanShowLateCompletions(client, serial, pos)) {
+					Metrics::Global().Increment("completion.merged");
+					ApplyCompletions(word_start, std::move(*prepared));
+				}
+			});
+		});
+	});
+
+	// Only drops its own interest, the request lives on for the one just made
+	prefetch.Discard();
+
+	if (client->wait(request_id, completion_deadline)) {
+		Metrics::Global().Increment("completion.server_in_time");
+		ShowCompletions(word_start, state->result, state->result.is_null() ? LocalCompletions(word_start) : std::vector<std::string>());
+	}
+	else {
+		Metrics::Global().Increment("completion.local_first");
+		state->late = true;
+		ShowCompletions(word_start, json(), LocalCompletions(word_start));
+	}
+}
+
+static void NextDiagnostic() {
+	diagnostics.GotoNext(true);
+}
+
+static void PreviousDiagnostic() {
+	diagnostics.GotoNext(false);
+}
+
+static void ShowProblems() {
+	static const int index = 4;
+	problems.Toggle((HINSTANCE)_hModule, index, funcItem[index]._cmdID);
+}
+
+static void OpenProblem(UriId uri, const Diagnostic &diagnostic) {
+	std::wstring path = UriToPath(diagnostics.Uris().Get(uri));
+	if (path.empty() || !npp.DoOpen(path))
+		return;
+
+	// Opening it made it the current document
+	diagnostics.Select(diagnostic);
+	editor.GrabFocus();
+}
+
+static void ShowStatistics() {
+	std::string report = Metrics::Global().Report();
+	std::wstring text(report.begin(), report.end());
+
+	MessageBox(npp.data._nppHandle, text.empty() ? L"Nothing to report yet" : text.c_str(), L"NppLsp Statistics", MB_OK);
 }
 
 static void ShowAbout() {
@@ -184,37 +521,117 @@ extern "C" __declspec(dllexport) FuncItem *getFuncsArray(int *nbF) {
 extern "C" __declspec(dllexport) void beNotified(SCNotification *notifyCode) {
 	switch (notifyCode->nmhdr.code) {
 		case SCN_DWELLSTART:
-			if (current_client && notifyCode->position != -1) {
-				std::string contents = current_client->requestHover(notifyCode->position)["contents"].get<std::string>();
-				if (contents.length() > 512) {
-					contents.resize(contents.find('\n', 512));
-					contents.append("\n...");
+			if (current_client && notifyCode->position != -1 && style_filter.ShouldRequest(StyleFilter::Hover, notifyCode->position, false))
+				hover.DwellStart(current_client, notifyCode->position);
+			break;
+		case SCN_DWELLEND:
+			hover.DwellEnd();
+			break;
+		case SCN_CALLTIPCLICK:
+			hover.CallTipClick(notifyCode->position);
+			break;
+		case SCN_CHARADDED:
+			if (current_client && current_client->isCompletionTrigger(notifyCode->ch) && style_filter.ShouldRequest(StyleFilter::Completion, editor.GetCurrentPos(), false))
+				prefetch.Trigger(current_client, editor.GetCurrentPos());
+			break;
+		case SCN_MODIFIED:
+			if (notifyCode->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)) {
+				// Only the document that was edited has to resync
+				BufferID buffer = BufferFromScintilla(notifyCode->nmhdr.hwndFrom);
+				auto edited = clients.find(buffer);
+				if (edited != clients.end())
+					edited->second->markDirty();
+
+				prefetch.Modified(notifyCode->position);
+				puller.Edited();
+
+				if (notifyCode->nmhdr.hwndFrom == editor.GetScintillaInstance()) {
+					identifiers.Modified(notifyCode);
+					positions.Modified(notifyCode);
+				}
+				else if (buffer != npp.GetCurrentBufferID()) {
+					// The tables can only follow edits through the active view, the other view's
+					// document is indexed again once it is shown
+					identifiers.Remove(buffer);
+					positions.Remove(buffer);
+				}
+
+				if (notifyCode->linesAdded != 0 && notifyCode->nmhdr.hwndFrom == editor.GetScintillaInstance()) {
+					diagnostics.Modified(editor.LineFromPosition(notifyCode->position), notifyCode->linesAdded);
+
+					// Shown with the next frame along with anything published
+					diagnostics_changed = true;
 				}
-				if (!contents.empty())
-					editor.CallTipShow(notifyCode->position, contents.c_str());
 			}
 			break;
-		case SCN_DWELLEND:
-			editor.CallTipCancel();
+		case SCN_UPDATEUI:
+			if (notifyCode->updated & SC_UPDATE_V_SCROLL)
+				diagnostics.UpdateViewport();
+			break;
+		case SCN_AUTOCSELECTIONCHANGE:
+			resolver.Highlight(editor.AutoCGetCurrent());
+			break;
+		case SCN_AUTOCSELECTION:
+		case SCN_AUTOCCANCELLED:
+			resolver.Cancel();
 			break;
 		case NPPN_READY:
-			editor.SetMouseDwellTime(100);
+			editor.CallTipSetForeHlt(0x804000);
+			editor.SetMouseDwellTime(GetPrivateProfileInt(L"Hover", L"DwellTime", 500, GetIniFilePath()));
 			for (size_t i = 0; i < xpm_images.size(); ++i) {
 				if (xpm_map[i] != 0) {
 					editor.RegisterImage(i, xpm_images[i]);
 				}
 			}
 			editor.RegisterImage(1, xpm_images[3]);
+
+			DiagnosticsEngine::Setup(ScintillaGateway(npp.data._scintillaMainHandle));
+			DiagnosticsEngine::Setup(ScintillaGateway(npp.data._scintillaSecondHandle));
+
+			prefetch.SetBudget(GetPrivateProfileInt(L"Completion", L"PrefetchBudget", 5, GetIniFilePath()));
+			completion_deadline = GetPrivateProfileInt(L"Completion", L"Deadline", 80, GetIniFilePath());
+			index_budget = GetPrivateProfileInt(L"Completion", L"IndexBudget", 2, GetIniFilePath());
+			style_filter.SetConfigFile(GetIniFilePath());
+			puller.SetDelay(GetPrivateProfileInt(L"Diagnostics", L"PullDelay", 300, GetIniFilePath()));
+			max_outstanding = GetPrivateProfileInt(L"Client", L"MaxOutstandingRequests", 32, GetIniFilePath());
+			max_queued_bytes = GetPrivateProfileInt(L"Client", L"MaxQueuedKB", 4096, GetIniFilePath()) * 1024;
+			ReadTimeouts();
+			apply_budget = GetPrivateProfileInt(L"Client", L"ApplyBudget", 4, GetIniFilePath());
+
+			problems.SetActivateHandler(OpenProblem);
+
+			// Whatever the servers sent is applied at most once per frame
+			poll_timer = SetTimer(NULL, 0, GetPrivateProfileInt(L"Client", L"FrameInterval", 16, GetIniFilePath()), PollClients);
 			break;
 		case NPPN_SHUTDOWN:
+			KillTimer(NULL, poll_timer);
+
+			// The pools are static, by the time they are destroyed the dll is being unloaded
+			// and their threads can no longer be joined, so they have to be stopped here
+			IoReactor::Global().Stop();
+			WorkPool::Global().Stop();
 			break;
 		case NPPN_BUFFERACTIVATED:
 			editor.SetScintillaInstance(npp.GetCurrentScintillaHwnd());
 
+			prefetch.Discard();
+			hover.Reset();
+			style_filter.SetLanguage(editor.GetLexerLanguage());
+			positions.Activate(npp.GetCurrentBufferID());
+
+			if (current_client)
+				current_client->setShown(false);
+
 			if (clients.find(npp.GetCurrentBufferID()) == clients.end()) {
 				if (editor.GetLexerLanguage() == "python") {
-					clients[npp.GetCurrentBufferID()] = new LspClient(editor);
+					std::string uri = PathToUri(npp.GetFullPathFromBufferID(npp.GetCurrentBufferID()));
+					clients[npp.GetCurrentBufferID()] = new LspClient(editor, positions, uri);
 					current_client = clients[npp.GetCurrentBufferID()];
+					LspClient *client = current_client;
+					current_client->setFlowLimits(max_outstanding, max_queued_bytes);
+					current_client->setNotificationHandler([client](const std::string &method, json &&params) {
+						HandleNotification(client, method, std::move(params));
+					});
 					current_client->notifyDidOpen();
 				}
 				else
@@ -224,22 +641,49 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification *notifyCode) {
 				// Client exists
 				current_client = clients[npp.GetCurrentBufferID()];
 			}
+
+			if (current_client)
+				current_client->setShown(true);
+
+			// Only documents with a server are worth completing words in
+			if (current_client)
+				identifiers.Activate(npp.GetCurrentBufferID());
+			else
+				identifiers.Deactivate();
+
+			// Catch up on anything published while it was in the background
+			diagnostics.SetCurrent(current_client ? current_client->getUri() : std::string());
+			UpdateStatusBar();
 			break;
 		case NPPN_FILESAVED: {
 			BufferID id = notifyCode->nmhdr.idFrom;
 			if (clients.find(id) != clients.end()) {
 				auto client = clients[id];
 				client->notifyDidSave();
+				puller.Saved(client);
 			}
 			break;
 		}
 		case NPPN_FILECLOSED: {
 			BufferID id = notifyCode->nmhdr.idFrom;
+			identifiers.Remove(id);
+			positions.Remove(id);
 			if (clients.find(id) != clients.end()) {
 				auto client = clients[id];
+				diagnostics.Close(client->getUri());
+				puller.Remove(client);
 				client->requestShutdown();
 				client->notifyExit();
 				clients.erase(id);
+
+				// Nothing may hold on to it once it is gone, work still in flight for it
+				// is told apart by its serial
+				if (current_client == client)
+					current_client = nullptr;
+				hover.Reset();
+				resolver.Reset(nullptr, std::vector<json>());
+				prefetch.Discard();
+				delete client;
 			}
 			break;
 		}
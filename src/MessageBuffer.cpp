@@ -0,0 +1,70 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "MessageBuffer.h"
+
+// "Content-Length: " followed by up to 20 digits and "\r\n\r\n"
+static const size_t header_space = 40;
+
+// Keep a buffer that grew for a huge message from hanging around forever
+static const size_t max_kept_capacity = 1024 * 1024;
+
+MessageBuffer::MessageBuffer() : serializer(detail::output_adapter<char, std::string>(buffer), ' ') {
+}
+
+void MessageBuffer::Begin() {
+	if (buffer.capacity() > max_kept_capacity)
+		std::string().swap(buffer);
+
+	buffer.assign(header_space, ' ');
+	start = 0;
+}
+
+void MessageBuffer::Append(const char *text, size_t length) {
+	buffer.append(text, length);
+}
+
+void MessageBuffer::Append(const json &j) {
+	serializer.dump(j, false, false, 0);
+}
+
+char *MessageBuffer::Extend(size_t length) {
+	size_t size = buffer.size();
+	buffer.resize(size + length);
+	return &buffer[size];
+}
+
+std::string MessageBuffer::Release(size_t &start) {
+	start = this->start;
+	this->start = 0;
+
+	// Moved out of rather than swapped so the serializer stays bound to the same string
+	std::string released = std::move(buffer);
+	buffer.clear();
+
+	return released;
+}
+
+void MessageBuffer::Finish() {
+	std::string header = "Content-Length: ";
+	header += std::to_string(buffer.size() - header_space);
+	header += "\r\n\r\n";
+
+	start = header_space - header.length();
+	buffer.replace(start, header.length(), header);
+}
@@ -0,0 +1,65 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <string>
+
+#include "json.hpp"
+
+using namespace nlohmann;
+
+// Builds outgoing messages in a single buffer that is reused from one message to
+// the next. Room for the header is left at the front, the body is serialized right
+// after it, and once the length of the body is known the header is written into
+// the space in front of it so the whole message can go out with one write.
+//
+// Document text is escaped straight into the buffer, and a finished message can be
+// released instead of copied, so the escaped text is the only copy of a document
+// that is ever made.
+class MessageBuffer final {
+public:
+	MessageBuffer();
+
+	// Starts a new message, anything from the previous one is thrown away
+	void Begin();
+
+	void Append(const char *text, size_t length);
+	void Append(const std::string &text) { Append(text.c_str(), text.length()); }
+	void Append(const json &j);
+
+	// Makes room for length bytes at the end of the body and returns where they start
+	char *Extend(size_t length);
+
+	// Writes the header, after this Data() and Size() are the complete message
+	void Finish();
+
+	const char *Data() const { return buffer.data() + start; }
+	size_t Size() const { return buffer.size() - start; }
+
+	// Hands over the storage of the finished message, which starts at start. The
+	// buffer is left empty and has to grow again for the next message.
+	std::string Release(size_t &start);
+
+private:
+	std::string buffer;
+	size_t start = 0;
+
+	// Serializes straight onto the end of the buffer
+	detail::serializer<json> serializer;
+};
@@ -0,0 +1,124 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "MessageInbox.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <chrono>
+
+// Only the most recent of these is worth applying
+static const char *coalesced_methods[] = {
+	"textDocument/publishDiagnostics",
+	"$/progress",
+	"window/logMessage",
+};
+
+bool MessageInbox::CoalesceKey(const json &message, std::pair<std::string, std::string> &key) {
+	// Responses always have an id
+	if (message.find("id") != message.end())
+		return false;
+
+	auto method = message.find("method");
+	if (method == message.end() || !method->is_string())
+		return false;
+
+	const std::string &name = method->get_ref<const std::string &>();
+	bool coalesce = false;
+	for (const char *m : coalesced_methods)
+		coalesce = coalesce || name == m;
+
+	if (!coalesce)
+		return false;
+
+	key.first = name;
+	key.second.clear();
+
+	auto params = message.find("params");
+	if (params != message.end() && params->is_object()) {
+		auto uri = params->find("uri");
+		auto token = params->find("token");
+
+		if (uri != params->end() && uri->is_string())
+			key.second = uri->get<std::string>();
+		else if (token != params->end())
+			key.second = token->dump();
+	}
+
+	return true;
+}
+
+void MessageInbox::Push(json &&message) {
+	std::pair<std::string, std::string> key;
+	bool coalesce = CoalesceKey(message, key);
+
+	if (message.find("id") == message.end())
+		Metrics::Global().Increment("notifications.received");
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (coalesce) {
+			auto it = latest.find(key);
+			if (it != latest.end()) {
+				// Leave a hole rather than moving everything after it
+				messages[it->second] = json();
+				Metrics::Global().Increment("notifications.coalesced");
+			}
+			latest[key] = messages.size();
+		}
+
+		messages.push_back(std::move(message));
+	}
+
+	ready.notify_all();
+}
+
+void MessageInbox::Close() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+	}
+
+	ready.notify_all();
+}
+
+bool MessageInbox::Wait(unsigned int timeout) {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	return ready.wait_for(lock, std::chrono::milliseconds(timeout), [this]() { return !messages.empty() || closed; });
+}
+
+std::vector<json> MessageInbox::Take() {
+	std::vector<json> taken;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		taken.swap(messages);
+		latest.clear();
+	}
+
+	taken.erase(std::remove_if(taken.begin(), taken.end(), [](const json &m) { return m.is_null(); }), taken.end());
+
+	return taken;
+}
+
+bool MessageInbox::IsClosed() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return closed;
+}
@@ -0,0 +1,61 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "json.hpp"
+
+using namespace nlohmann;
+
+// Messages read from a server waiting to be handled on the UI thread.
+//
+// Some notifications only describe the latest state of something (the diagnostics
+// of a document, the progress of a task) so if another one for the same method and
+// uri arrives before the UI got around to the first, the first is dropped.
+class MessageInbox final {
+public:
+	// Called from the reactor's threads
+	void Push(json &&message);
+
+	// The server is gone, nothing else will be pushed
+	void Close();
+
+	// Blocks until there is something to take, the inbox was closed, or the timeout expires
+	bool Wait(unsigned int timeout);
+
+	// Everything received so far, in the order it arrived
+	std::vector<json> Take();
+
+	bool IsClosed() const;
+
+private:
+	mutable std::mutex mutex;
+	std::condition_variable ready;
+	std::vector<json> messages;
+	std::map<std::pair<std::string, std::string>, size_t> latest;
+	bool closed = false;
+
+	static bool CoalesceKey(const json &message, std::pair<std::string, std::string> &key);
+};
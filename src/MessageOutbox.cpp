@@ -0,0 +1,133 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "MessageOutbox.h"
+#include "Metrics.h"
+
+void MessageOutbox::Push(std::string &&storage, size_t start, Priority priority, const std::string &key) {
+	size_t size = storage.size() - start;
+	bool merged = false;
+	long long removed = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Message *waiting = nullptr;
+		auto &queue = queues[priority];
+		for (auto it = queue.rbegin(); it != queue.rend() && waiting == nullptr && !key.empty(); ++it) {
+			if (it->key == key)
+				waiting = &*it;
+		}
+
+		// Anything queued after the older one was made against what it says, so then it
+		// has to reach the server as it is and the newer one just goes after it
+		if (waiting && waiting->sequence + 1 == next_sequence) {
+			merged = true;
+			removed = static_cast<long long>(waiting->Size());
+			bytes -= waiting->Size();
+			waiting->storage = std::move(storage);
+			waiting->start = start;
+		}
+		else {
+			depth++;
+			queue.push_back({ next_sequence++, std::move(storage), start, key });
+		}
+
+		bytes += size;
+	}
+
+	if (merged)
+		Metrics::Global().Increment("outbound.merged");
+
+	// Summed over every server
+	Metrics::Global().Increment("outbound.queue_depth", merged ? 0 : 1);
+	Metrics::Global().Increment("outbound.queue_bytes", static_cast<long long>(size) - removed);
+}
+
+int MessageOutbox::Next() const {
+	const unsigned long long none = ~0ULL;
+	unsigned long long sync = queues[Sync].empty() ? none : queues[Sync].front().sequence;
+
+	// The most important message that was queued before the next sync message
+	for (int priority = Interactive; priority < PriorityCount; ++priority) {
+		if (!queues[priority].empty() && queues[priority].front().sequence < sync)
+			return priority;
+	}
+
+	// Everything else came after it
+	return sync != none ? Sync : -1;
+}
+
+bool MessageOutbox::Take(std::string &batch, size_t &start, size_t max_batch) {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (depth == 0)
+		return false;
+
+	start = 0;
+	size_t taken = 0;
+	size_t messages = 0;
+	for (int priority = Next(); priority != -1; priority = Next()) {
+		Message &message = queues[priority].front();
+		size_t size = message.Size();
+
+		if (size > max_batch) {
+			// Written straight from its own storage, copying it into a batch gains nothing
+			if (messages != 0)
+				break;
+
+			batch = std::move(message.storage);
+			start = message.start;
+		}
+		else if (batch.size() + size > max_batch) {
+			break;
+		}
+		else {
+			batch.append(message.storage, message.start, std::string::npos);
+		}
+
+		bytes -= size;
+		taken += size;
+		depth--;
+		messages++;
+		queues[priority].pop_front();
+
+		if (size > max_batch)
+			break;
+	}
+
+	lock.unlock();
+
+	Metrics::Global().Increment("outbound.queue_depth", -static_cast<long long>(messages));
+	Metrics::Global().Increment("outbound.queue_bytes", -static_cast<long long>(taken));
+	Metrics::Global().Increment("outbound.batches");
+	Metrics::Global().Increment("outbound.messages", static_cast<long long>(messages));
+	Metrics::Global().Increment("outbound.bytes", static_cast<long long>(taken));
+
+	return true;
+}
+
+size_t MessageOutbox::Depth() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return depth;
+}
+
+size_t MessageOutbox::Bytes() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return bytes;
+}
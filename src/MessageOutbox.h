@@ -0,0 +1,78 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <string>
+
+// Messages waiting to be written to a server.
+//
+// Messages are written by priority so a completion the user is waiting on does not
+// sit behind a pile of background requests. Document sync is the exception: the
+// server has to see the text before anything that refers to it, so a Sync message
+// is only written once everything queued before it has been, and nothing queued
+// after it can get ahead of it.
+//
+// A message pushed with a key replaces one with the same key that is still waiting
+// to be written, which is how changes to a document pile up into a single update
+// when the server is not keeping up. Only the newest message can be replaced
+// though, requests queued after it were made against its text and have to be
+// answered against that text too.
+class MessageOutbox final {
+public:
+	enum Priority {
+		Sync,
+		Interactive,
+		Normal,
+		Background,
+		PriorityCount
+	};
+
+	// Called from the UI thread, never blocks on the pipe. The message is the part of
+	// the storage from start on, so a MessageBuffer can be handed over as it is.
+	void Push(std::string &&storage, size_t start, Priority priority, const std::string &key = std::string());
+
+	// Called when the previous write is done, batch is empty. A message bigger than
+	// max_batch is moved into batch as it is and start is set to where it begins,
+	// otherwise as many small messages as fit are appended and start is 0. Returns
+	// false if nothing is queued.
+	bool Take(std::string &batch, size_t &start, size_t max_batch);
+
+	size_t Depth() const;
+	size_t Bytes() const;
+
+private:
+	struct Message {
+		unsigned long long sequence;
+		std::string storage;
+		size_t start;
+		std::string key;
+
+		size_t Size() const { return storage.size() - start; }
+	};
+
+	mutable std::mutex mutex;
+	std::deque<Message> queues[PriorityCount];
+	unsigned long long next_sequence = 0;
+	size_t depth = 0;
+	size_t bytes = 0;
+
+	int Next() const;
+};
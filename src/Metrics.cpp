@@ -0,0 +1,55 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "Metrics.h"
+
+Metrics &Metrics::Global() {
+	static Metrics metrics;
+	return metrics;
+}
+
+void Metrics::Increment(const std::string &name, long long amount) {
+	std::lock_guard<std::mutex> lock(mutex);
+	counters[name] += amount;
+}
+
+void Metrics::Set(const std::string &name, long long value) {
+	std::lock_guard<std::mutex> lock(mutex);
+	counters[name] = value;
+}
+
+long long Metrics::Get(const std::string &name) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = counters.find(name);
+	return it == counters.end() ? 0 : it->second;
+}
+
+std::string Metrics::Report() const {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::string report;
+
+	for (const auto &counter : counters) {
+		report += counter.first;
+		report += " = ";
+		report += std::to_string(counter.second);
+		report += "\r\n";
+	}
+
+	return report;
+}
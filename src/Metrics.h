@@ -0,0 +1,39 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+
+// Simple named counters for keeping an eye on what the plugin is doing. Safe to use from any thread.
+class Metrics final {
+public:
+	static Metrics &Global();
+
+	void Increment(const std::string &name, long long amount = 1);
+	void Set(const std::string &name, long long value);
+	long long Get(const std::string &name) const;
+
+	std::string Report() const;
+
+private:
+	mutable std::mutex mutex;
+	std::map<std::string, long long> counters;
+};
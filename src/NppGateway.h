@@ -19,6 +19,7 @@
 #pragma once
 
 #include "npp\PluginInterface.h"
+#include "npp\Docking.h"
 
 #include <string>
 
@@ -80,7 +81,10 @@ public:
 	//NPPM_CREATESCINTILLAHANDLE
 	//NPPM_DESTROYSCINTILLAHANDLE
 	//NPPM_GETNBUSERLANG
-	//NPPM_GETCURRENTDOCINDEX
+
+	int GetCurrentDocIndex(int view) const {
+		return static_cast<int>(Call(NPPM_GETCURRENTDOCINDEX, 0, view));
+	}
 
 	void SetStatusBar(int section, const wchar_t *status) const {
 		Call(NPPM_SETSTATUSBAR, section, status);
@@ -95,10 +99,23 @@ public:
 	//NPPM_DECODESCI
 	//NPPM_ACTIVATEDOC
 	//NPPM_LAUNCHFINDINFILESDLG
-	//NPPM_DMMSHOW
-	//NPPM_DMMHIDE
-	//NPPM_DMMUPDATEDISPINFO
-	//NPPM_DMMREGASDCKDLG
+
+	void DmmShow(HWND hClient) const {
+		Call(NPPM_DMMSHOW, 0, hClient);
+	}
+
+	void DmmHide(HWND hClient) const {
+		Call(NPPM_DMMHIDE, 0, hClient);
+	}
+
+	void DmmUpdateDispInfo(HWND hClient) const {
+		Call(NPPM_DMMUPDATEDISPINFO, 0, hClient);
+	}
+
+	void DmmRegAsDckDlg(tTbData *data) const {
+		Call(NPPM_DMMREGASDCKDLG, 0, data);
+	}
+
 	//NPPM_LOADSESSION
 	//NPPM_DMMVIEWOTHERTAB
 	//NPPM_RELOADFILE
@@ -157,7 +174,9 @@ public:
 		return text;
 	}
 
-	//NPPM_GETBUFFERIDFROMPOS
+	BufferID GetBufferIDFromPos(int index, int view) const {
+		return Call(NPPM_GETBUFFERIDFROMPOS, index, view);
+	}
 
 	BufferID GetCurrentBufferID() const {
 		return Call(NPPM_GETCURRENTBUFFERID, 0, 0);
@@ -0,0 +1,185 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "PipeChannel.h"
+#include "Metrics.h"
+
+static const size_t read_size = 64 * 1024;
+
+// Whatever has piled up while the last write was going out is written together,
+// anything bigger on its own
+static const size_t max_batch = 64 * 1024;
+
+PipeChannel::PipeChannel(IoReactor &reactor, HANDLE input, HANDLE output, MessageOutbox &outbox, DataHandler handler) :
+	reactor(reactor), input(input), output(output), outbox(outbox), handler(handler), buffer(read_size) {
+	read.channel = this;
+	write.channel = this;
+	kick.channel = this;
+
+	reactor.Attach(input);
+	reactor.Attach(output);
+}
+
+PipeChannel::~PipeChannel() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closing = true;
+	}
+
+	CancelIoEx(input, NULL);
+	CancelIoEx(output, NULL);
+
+	// Nothing will ever complete once the reactor is gone
+	if (!reactor.IsRunning())
+		return;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this]() { return outstanding == 0; });
+}
+
+bool PipeChannel::Begin() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (closing)
+		return false;
+
+	outstanding++;
+	return true;
+}
+
+void PipeChannel::Finished() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		outstanding--;
+	}
+
+	idle.notify_all();
+}
+
+void PipeChannel::Start() {
+	StartRead();
+}
+
+void PipeChannel::StartRead() {
+	if (!Begin())
+		return;
+
+	if (!ReadFile(output, buffer.data(), static_cast<DWORD>(buffer.size()), NULL, &read.overlapped) && GetLastError() != ERROR_IO_PENDING) {
+		handler(nullptr, 0);
+		Finished();
+	}
+}
+
+void PipeChannel::ReadDone(DWORD bytes, DWORD error) {
+	if (error != 0 || bytes == 0) {
+		// Cancelled because the channel is going away, nobody needs to hear about it
+		if (error != ERROR_OPERATION_ABORTED)
+			handler(nullptr, 0);
+	}
+	else {
+		Metrics::Global().Increment("io.reads");
+		handler(buffer.data(), bytes);
+		StartRead();
+	}
+
+	Finished();
+}
+
+void PipeChannel::Flush() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (writing || closing)
+			return;
+
+		writing = true;
+		outstanding++;
+	}
+
+	reactor.Post(&kick);
+}
+
+bool PipeChannel::Drain(DWORD timeout) {
+	Flush();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	return idle.wait_for(lock, std::chrono::milliseconds(timeout), [this]() { return !writing; });
+}
+
+void PipeChannel::WriteNext() {
+	batch.clear();
+	written = 0;
+
+	{
+		// Checked with the lock held so a Flush() can not slip in between deciding
+		// there is nothing to write and no longer being marked as writing
+		std::lock_guard<std::mutex> lock(mutex);
+		if (outbox.Depth() == 0) {
+			writing = false;
+			idle.notify_all();
+			return;
+		}
+	}
+
+	if (!outbox.Take(batch, written, max_batch)) {
+		StopWriting();
+		return;
+	}
+
+	StartWrite();
+}
+
+void PipeChannel::StartWrite() {
+	if (!Begin()) {
+		StopWriting();
+		return;
+	}
+
+	DWORD length = static_cast<DWORD>(batch.size() - written);
+	if (!WriteFile(input, batch.data() + written, length, NULL, &write.overlapped) && GetLastError() != ERROR_IO_PENDING) {
+		// The server is gone, whatever is left in the outbox stays there
+		StopWriting();
+		Finished();
+	}
+}
+
+void PipeChannel::WriteDone(DWORD bytes, DWORD error) {
+	if (error != 0) {
+		StopWriting();
+	}
+	else {
+		Metrics::Global().Increment("io.writes");
+
+		written += bytes;
+		if (written < batch.size())
+			StartWrite();
+		else
+			WriteNext();
+	}
+
+	Finished();
+}
+
+void PipeChannel::StopWriting() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		writing = false;
+	}
+
+	idle.notify_all();
+}
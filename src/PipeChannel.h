@@ -0,0 +1,104 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <windows.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "IoReactor.h"
+#include "MessageOutbox.h"
+
+// A server's stdin and stdout, read and written through the reactor. Whatever is
+// read is handed to the data handler on one of the reactor's threads, and whatever
+// is in the outbox is written once Flush() has been called. There is never more than
+// one read and one write going on at a time.
+class PipeChannel final {
+public:
+	// Called on a reactor thread, with no data once the server has closed the pipe
+	typedef std::function<void(const char *data, size_t length)> DataHandler;
+
+	// Both handles have to be opened for overlapped I/O
+	PipeChannel(IoReactor &reactor, HANDLE input, HANDLE output, MessageOutbox &outbox, DataHandler handler);
+
+	// Cancels whatever is going on and waits for it to finish
+	~PipeChannel();
+
+	// Starts reading
+	void Start();
+
+	// Something was pushed to the outbox
+	void Flush();
+
+	// Waits until the outbox has been written out, or the timeout expires
+	bool Drain(DWORD timeout);
+
+private:
+	struct Read : IoReactor::Operation {
+		PipeChannel *channel;
+		void Complete(DWORD bytes, DWORD error) override { channel->ReadDone(bytes, error); }
+	};
+
+	struct Write : IoReactor::Operation {
+		PipeChannel *channel;
+		void Complete(DWORD bytes, DWORD error) override { channel->WriteDone(bytes, error); }
+	};
+
+	// Gets a write going from one of the reactor's threads
+	struct Kick : IoReactor::Operation {
+		PipeChannel *channel;
+		void Complete(DWORD bytes, DWORD error) override { channel->WriteNext(); channel->Finished(); }
+	};
+
+	IoReactor &reactor;
+	HANDLE input;
+	HANDLE output;
+	MessageOutbox &outbox;
+	DataHandler handler;
+
+	Read read;
+	Write write;
+	Kick kick;
+
+	std::vector<char> buffer;
+	std::string batch;
+	size_t written = 0;
+
+	std::mutex mutex;
+	std::condition_variable idle;
+	int outstanding = 0;
+	bool writing = false;
+	bool closing = false;
+
+	bool Begin();
+	void Finished();
+
+	void StartRead();
+	void ReadDone(DWORD bytes, DWORD error);
+
+	void WriteNext();
+	void StartWrite();
+	void WriteDone(DWORD bytes, DWORD error);
+	void StopWriting();
+};
@@ -0,0 +1,248 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "PositionIndex.h"
+#include "Utf8.h"
+
+#include <algorithm>
+
+// Lines at least this long get a table of UTF-16 offsets every so many bytes
+static const int checkpoint_interval = 16 * 1024;
+static const int long_line = 2 * checkpoint_interval;
+
+// Text is read in pieces that do not cross Scintilla's gap so the gap never has to be
+// moved, which for an edit in the middle of a huge line would mean moving most of it
+static bool IsAsciiRange(ScintillaGateway &editor, int start, int end) {
+	int gap = editor.GetGapPosition();
+
+	if (gap > start && gap < end)
+		return IsAscii(editor.GetRangePointer(start, gap - start), gap - start) && IsAscii(editor.GetRangePointer(gap, end - gap), end - gap);
+
+	return IsAscii(editor.GetRangePointer(start, end - start), end - start);
+}
+
+PositionIndex::PositionIndex(ScintillaGateway &editor) : editor(editor) {
+}
+
+void PositionIndex::Activate(uptr_t document) {
+	auto it = documents.find(document);
+	if (it != documents.end()) {
+		current = &it->second;
+		return;
+	}
+
+	current = &documents[document];
+	Reset();
+}
+
+void PositionIndex::Remove(uptr_t document) {
+	auto it = documents.find(document);
+	if (it == documents.end())
+		return;
+
+	if (current == &it->second)
+		current = nullptr;
+
+	documents.erase(it);
+}
+
+void PositionIndex::Modified(const SCNotification *notifyCode) {
+	if (current == nullptr || !(notifyCode->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+		return;
+
+	// Notifications could have been missed (e.g. coming from the other view) so start over
+	if ((int)current->kinds.size() + notifyCode->linesAdded != editor.GetLineCount()) {
+		Reset();
+		return;
+	}
+
+	int line = editor.LineFromPosition(notifyCode->position);
+	int offset = notifyCode->position - editor.PositionFromLine(line);
+	int added = notifyCode->linesAdded;
+	auto &lines = current->kinds;
+
+	// What the changed lines are made of now, without reading them again. Text added to a
+	// line can only make it ASCII if both were, text removed from a Unicode line may have
+	// taken the last non-ASCII character with it but treating it as Unicode is still right.
+	LineKind kind;
+	if (notifyCode->modificationType & SC_MOD_INSERTTEXT) {
+		bool ascii_text = notifyCode->text != nullptr && IsAscii(notifyCode->text, notifyCode->length);
+
+		if (lines[line] == Ascii && ascii_text)
+			kind = Ascii;
+		else if (!ascii_text && added == 0)
+			kind = Unicode;
+		else
+			kind = added == 0 ? static_cast<LineKind>(lines[line]) : Unknown;
+	}
+	else {
+		kind = static_cast<LineKind>(lines[line]);
+		for (int i = line + 1; i <= line - added; ++i) {
+			if (lines[i] != Ascii)
+				kind = Unknown;
+		}
+	}
+
+	if (added > 0)
+		lines.insert(lines.begin() + line + 1, added, Unknown);
+	else if (added < 0)
+		lines.erase(lines.begin() + line + 1, lines.begin() + line + 1 - added);
+
+	for (int i = line; i <= line + std::max(added, 0); ++i)
+		lines[i] = kind;
+
+	// The changed line keeps the checkpoints before the edit, tables of removed lines are
+	// gone and the ones after them move
+	if (!current->checkpoints.empty()) {
+		std::map<int, std::vector<size_t>> moved;
+		int last_changed = line - std::min(added, 0);
+		size_t kept = offset / checkpoint_interval + 1;
+
+		for (auto &table : current->checkpoints) {
+			if (table.first < line) {
+				moved[table.first] = std::move(table.second);
+			}
+			else if (table.first == line) {
+				if (table.second.size() > kept)
+					table.second.resize(kept);
+				moved[line] = std::move(table.second);
+			}
+			else if (table.first > last_changed) {
+				moved[table.first + added] = std::move(table.second);
+			}
+		}
+
+		current->checkpoints.swap(moved);
+	}
+}
+
+void PositionIndex::ToLsp(int position, int &line, int &character, Encoding encoding) {
+	line = editor.LineFromPosition(position);
+	int start = editor.PositionFromLine(line);
+	int length = position - start;
+
+	if (encoding == Utf8 || Kind(line) == Ascii) {
+		character = length;
+		return;
+	}
+
+	const std::vector<size_t> *table = Checkpoints(line, length, 0);
+
+	// Only the part after the closest checkpoint needs counting
+	size_t k = table ? length / checkpoint_interval : 0;
+	size_t units = table ? (*table)[k] : 0;
+	size_t offset = k * checkpoint_interval;
+
+	const char *text = editor.GetRangePointer(start + offset, length - offset);
+	character = static_cast<int>(units + Utf16Length(text, length - offset));
+}
+
+json PositionIndex::ToLsp(int position, Encoding encoding) {
+	int line, character;
+	ToLsp(position, line, character, encoding);
+
+	return json({ { "line", line }, { "character", character } });
+}
+
+int PositionIndex::FromLsp(int line, int character, Encoding encoding) {
+	if (line >= editor.GetLineCount())
+		return editor.GetLength();
+	if (line < 0 || character <= 0)
+		return line < 0 ? 0 : editor.PositionFromLine(line);
+
+	int start = editor.PositionFromLine(line);
+	int length = editor.GetLineEndPosition(line) - start;
+
+	if (encoding == Utf8 || Kind(line) == Ascii)
+		return start + std::min(character, length);
+
+	const std::vector<size_t> *table = Checkpoints(line, 0, character);
+	size_t offset = 0;
+	size_t units = character;
+
+	if (table) {
+		// The last checkpoint at or before the character
+		size_t k = std::upper_bound(table->begin(), table->end(), units) - table->begin() - 1;
+		offset = k * checkpoint_interval;
+		units -= (*table)[k];
+	}
+
+	// A UTF-16 code unit never takes more than 3 bytes, so only that much is read
+	size_t available = length - offset;
+	size_t needed = units * 3 + 3 < available ? units * 3 + 3 : available;
+	const char *text = editor.GetRangePointer(start + static_cast<int>(offset), static_cast<int>(needed));
+	size_t skipped = 0;
+
+	// The character spanning the checkpoint was already counted
+	while (skipped < needed && (static_cast<unsigned char>(text[skipped]) & 0xC0) == 0x80)
+		++skipped;
+
+	return start + static_cast<int>(offset + skipped + Utf8Length(text + skipped, needed - skipped, units));
+}
+
+int PositionIndex::FromLsp(const json &position, Encoding encoding) {
+	return FromLsp(position.value("line", 0), position.value("character", 0), encoding);
+}
+
+PositionIndex::LineKind PositionIndex::Kind(int line) {
+	// Anything that is not UTF-8 is treated as one byte per character
+	if (editor.GetCodePage() != SC_CP_UTF8)
+		return Ascii;
+
+	if (current != nullptr && line < (int)current->kinds.size() && current->kinds[line] != Unknown)
+		return static_cast<LineKind>(current->kinds[line]);
+
+	int start = editor.PositionFromLine(line);
+	LineKind kind = IsAsciiRange(editor, start, editor.GetLineEndPosition(line)) ? Ascii : Unicode;
+
+	if (current != nullptr && line < (int)current->kinds.size())
+		current->kinds[line] = kind;
+
+	return kind;
+}
+
+const std::vector<size_t> *PositionIndex::Checkpoints(int line, size_t offset, size_t units) {
+	if (current == nullptr)
+		return nullptr;
+
+	int start = editor.PositionFromLine(line);
+	int length = editor.GetLineEndPosition(line) - start;
+	if (length < long_line)
+		return nullptr;
+
+	// The number of UTF-16 code units before every checkpoint, counted only as far as
+	// needed since an edit drops the ones after it
+	std::vector<size_t> &table = current->checkpoints[line];
+	if (table.empty())
+		table.push_back(0);
+
+	size_t last = length / checkpoint_interval;
+	size_t wanted = offset / checkpoint_interval < last ? offset / checkpoint_interval : last;
+
+	while (table.size() - 1 < last && (table.size() - 1 < wanted || (units != 0 && table.back() <= units))) {
+		int from = start + static_cast<int>((table.size() - 1) * checkpoint_interval);
+		table.push_back(table.back() + Utf16Length(editor.GetRangePointer(from, checkpoint_interval), checkpoint_interval));
+	}
+
+	return &table;
+}
+
+void PositionIndex::Reset() {
+	current->kinds.assign(editor.GetLineCount(), Unknown);
+	current->checkpoints.clear();
+}
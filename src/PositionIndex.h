@@ -0,0 +1,83 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "ScintillaGateway.h"
+#include "json.hpp"
+
+using namespace nlohmann;
+
+// Converts between Scintilla positions, which are byte offsets into the UTF-8 text,
+// and LSP positions, which are a line and an offset in UTF-16 code units. Lines are
+// found with Scintilla's own line index. Which lines are pure ASCII is remembered
+// for each document since for those the byte and UTF-16 offsets are the same.
+// A server using UTF-8 positions needs no conversion at all.
+// Very long lines also get a table of UTF-16 offsets at fixed byte intervals so
+// no conversion has to count more than one interval's worth of text.
+class PositionIndex final {
+public:
+	// What the server counts the characters of a line in
+	enum Encoding {
+		Utf16,
+		Utf8
+	};
+
+	explicit PositionIndex(ScintillaGateway &editor);
+
+	// The document is now shown in the editor
+	void Activate(uptr_t document);
+	void Remove(uptr_t document);
+
+	// Called for SCN_MODIFIED of the currently active document
+	void Modified(const SCNotification *notifyCode);
+
+	void ToLsp(int position, int &line, int &character, Encoding encoding = Utf16);
+	json ToLsp(int position, Encoding encoding = Utf16);
+
+	// Positions past the end of a line are clamped to it
+	int FromLsp(int line, int character, Encoding encoding = Utf16);
+	int FromLsp(const json &position, Encoding encoding = Utf16);
+
+private:
+	enum LineKind : unsigned char {
+		Unknown,
+		Ascii,
+		Unicode
+	};
+
+	ScintillaGateway &editor;
+
+	struct Document {
+		std::vector<unsigned char> kinds;
+		std::map<int, std::vector<size_t>> checkpoints;
+	};
+
+	std::unordered_map<uptr_t, Document> documents;
+	Document *current = nullptr;
+
+	LineKind Kind(int line);
+	// The table of a long line, with at least the checkpoints up to the byte offset and,
+	// unless it is 0, past the given number of UTF-16 code units
+	const std::vector<size_t> *Checkpoints(int line, size_t offset, size_t units);
+	void Reset();
+};
@@ -0,0 +1,211 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "ProblemsPanel.h"
+
+#include "npp\dockingResource.h"
+
+static const wchar_t *class_name = L"NppLspProblems";
+static const wchar_t *severities[] = { L"", L"Error", L"Warning", L"Information", L"Hint" };
+
+enum Column {
+	SeverityColumn,
+	FileColumn,
+	LineColumn,
+	MessageColumn
+};
+
+static std::wstring Widen(const std::string &text) {
+	if (text.empty())
+		return std::wstring();
+
+	int size = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), (int)text.length(), NULL, 0);
+	std::wstring wide(size, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, text.c_str(), (int)text.length(), &wide[0], size);
+	return wide;
+}
+
+ProblemsPanel::ProblemsPanel(const NppGateway &npp, const DiagnosticsEngine &diagnostics) : npp(npp), diagnostics(diagnostics) {
+	summary[0] = L'\0';
+}
+
+void ProblemsPanel::Toggle(HINSTANCE instance, int command_index, int command_id) {
+	this->command_id = command_id;
+
+	if (window == NULL) {
+		Create(instance, command_index);
+		visible = true;
+	}
+	else {
+		visible = !visible;
+		if (visible)
+			npp.DmmShow(window);
+		else
+			npp.DmmHide(window);
+	}
+
+	npp.SetMenuItemCheck(command_id, visible);
+
+	if (visible)
+		Refresh();
+}
+
+void ProblemsPanel::Refresh() {
+	if (window == NULL || !visible)
+		return;
+
+	// Only the count is handed over, the rows are asked for as they are drawn
+	ListView_SetItemCountEx(list, diagnostics.Rows(), LVSICF_NOSCROLL);
+	InvalidateRect(list, NULL, FALSE);
+
+	auto counts = diagnostics.WorkspaceCounts();
+	std::wstring text = std::to_wstring(counts[1]) + L" errors, " + std::to_wstring(counts[2]) + L" warnings";
+	if (text != summary) {
+		wcsncpy_s(summary, sizeof(summary) / sizeof(summary[0]), text.c_str(), _TRUNCATE);
+		npp.DmmUpdateDispInfo(window);
+	}
+}
+
+void ProblemsPanel::Create(HINSTANCE instance, int command_index) {
+	WNDCLASS wc = { 0 };
+	wc.lpfnWndProc = WindowProc;
+	wc.hInstance = instance;
+	wc.lpszClassName = class_name;
+	RegisterClass(&wc);
+
+	window = CreateWindowEx(0, class_name, L"Problems", WS_CHILD | WS_CLIPCHILDREN, 0, 0, 0, 0, npp.data._nppHandle, NULL, instance, this);
+
+	list = CreateWindowEx(0, WC_LISTVIEW, L"", WS_CHILD | WS_VISIBLE | LVS_REPORT | LVS_OWNERDATA | LVS_SINGLESEL | LVS_SHOWSELALWAYS, 0, 0, 0, 0, window, NULL, instance, NULL);
+	ListView_SetExtendedListViewStyle(list, LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER);
+
+	static const struct {
+		const wchar_t *name;
+		int width;
+	} columns[] = {
+		{ L"Severity", 80 },
+		{ L"File", 160 },
+		{ L"Line", 50 },
+		{ L"Message", 600 },
+	};
+
+	for (int i = 0; i < (int)(sizeof(columns) / sizeof(columns[0])); ++i) {
+		LVCOLUMN column = { 0 };
+		column.mask = LVCF_TEXT | LVCF_WIDTH;
+		column.pszText = const_cast<wchar_t *>(columns[i].name);
+		column.cx = columns[i].width;
+		ListView_InsertColumn(list, i, &column);
+	}
+
+	// The docking manager identifies the plugin by its file name
+	wchar_t path[MAX_PATH] = { 0 };
+	GetModuleFileName((HMODULE)instance, path, MAX_PATH);
+	module_name = path;
+	module_name = module_name.substr(module_name.find_last_of(L'\\') + 1);
+
+	dock_data = tTbData();
+	dock_data.hClient = window;
+	dock_data.pszName = L"Problems";
+	dock_data.dlgID = command_index;
+	dock_data.uMask = DWS_DF_CONT_BOTTOM | DWS_ADDINFO;
+	dock_data.pszAddInfo = summary;
+	dock_data.pszModuleName = module_name.c_str();
+
+	npp.DmmRegAsDckDlg(&dock_data);
+	npp.DmmShow(window);
+}
+
+void ProblemsPanel::GetDisplayInfo(NMLVDISPINFO *info) const {
+	if (!(info->item.mask & LVIF_TEXT))
+		return;
+
+	UriId uri;
+	const Diagnostic *d = diagnostics.Row(info->item.iItem, uri);
+	if (d == nullptr) {
+		info->item.pszText[0] = L'\0';
+		return;
+	}
+
+	std::wstring text;
+	switch (info->item.iSubItem) {
+		case SeverityColumn:
+			text = severities[d->severity];
+			break;
+		case FileColumn: {
+			text = UriToPath(diagnostics.Uris().Get(uri));
+			text = text.substr(text.find_last_of(L'\\') + 1);
+			break;
+		}
+		case LineColumn:
+			text = std::to_wstring(d->start_line + 1);
+			break;
+		case MessageColumn:
+			text = Widen(d->message);
+			break;
+	}
+
+	wcsncpy_s(info->item.pszText, info->item.cchTextMax, text.c_str(), _TRUNCATE);
+}
+
+LRESULT ProblemsPanel::Notify(NMHDR *header) {
+	if (header->hwndFrom == list) {
+		switch (header->code) {
+			case LVN_GETDISPINFO:
+				GetDisplayInfo(reinterpret_cast<NMLVDISPINFO *>(header));
+				return 0;
+			case LVN_ITEMACTIVATE: {
+				UriId uri;
+				const Diagnostic *d = diagnostics.Row(reinterpret_cast<NMITEMACTIVATE *>(header)->iItem, uri);
+
+				// Opening the file can publish new diagnostics so hand over a copy
+				if (d && activate_handler) {
+					Diagnostic diagnostic = *d;
+					activate_handler(uri, diagnostic);
+				}
+				return 0;
+			}
+		}
+	}
+	else if (header->hwndFrom == window && LOWORD(header->code) == DMN_CLOSE) {
+		visible = false;
+		npp.SetMenuItemCheck(command_id, false);
+	}
+
+	return 0;
+}
+
+LRESULT CALLBACK ProblemsPanel::WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) {
+	if (message == WM_NCCREATE) {
+		auto create = reinterpret_cast<LPCREATESTRUCT>(lParam);
+		SetWindowLongPtr(hwnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(create->lpCreateParams));
+	}
+
+	auto panel = reinterpret_cast<ProblemsPanel *>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
+
+	switch (message) {
+		case WM_SIZE:
+			if (panel && panel->list)
+				MoveWindow(panel->list, 0, 0, LOWORD(lParam), HIWORD(lParam), TRUE);
+			return 0;
+		case WM_NOTIFY:
+			if (panel)
+				return panel->Notify(reinterpret_cast<NMHDR *>(lParam));
+			break;
+	}
+
+	return DefWindowProc(hwnd, message, wParam, lParam);
+}
@@ -0,0 +1,66 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <windows.h>
+#include <commctrl.h>
+#include <functional>
+#include <string>
+
+#include "NppGateway.h"
+#include "Diagnostics.h"
+
+// A dockable list of the diagnostics in every document. The list is virtual so
+// only the rows on screen are ever asked for, no matter how many there are.
+class ProblemsPanel final {
+public:
+	typedef std::function<void(UriId uri, const Diagnostic &diagnostic)> ActivateHandler;
+
+	ProblemsPanel(const NppGateway &npp, const DiagnosticsEngine &diagnostics);
+
+	// The first time it is shown the panel is created and registered with the docking manager.
+	// The command is the menu item that toggles it.
+	void Toggle(HINSTANCE instance, int command_index, int command_id);
+
+	// The diagnostics changed, redraws whatever is on screen
+	void Refresh();
+
+	// Called when a row is double clicked
+	void SetActivateHandler(ActivateHandler handler) { activate_handler = handler; }
+
+private:
+	const NppGateway &npp;
+	const DiagnosticsEngine &diagnostics;
+	ActivateHandler activate_handler;
+
+	HWND window = NULL;
+	HWND list = NULL;
+	bool visible = false;
+	int command_id = 0;
+
+	tTbData dock_data;
+	std::wstring module_name;
+	wchar_t summary[64];
+
+	void Create(HINSTANCE instance, int command_index);
+	void GetDisplayInfo(NMLVDISPINFO *info) const;
+	LRESULT Notify(NMHDR *header);
+
+	static LRESULT CALLBACK WindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam);
+};
@@ -0,0 +1,172 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "StyleFilter.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cwchar>
+#include <vector>
+
+struct DefaultStyles {
+	const char *language;
+	std::vector<int> comments;
+	std::vector<int> strings;
+};
+
+// Style numbers come from SciLexer.h
+static const DefaultStyles defaults[] = {
+	// SCE_P_COMMENTLINE, SCE_P_COMMENTBLOCK
+	// SCE_P_STRING, SCE_P_CHARACTER, SCE_P_TRIPLE, SCE_P_TRIPLEDOUBLE, SCE_P_STRINGEOL, SCE_P_FSTRING...SCE_P_FTRIPLEDOUBLE
+	{ "python", { 1, 12 }, { 3, 4, 6, 7, 13, 16, 17, 18, 19 } },
+	// SCE_C_COMMENT, SCE_C_COMMENTLINE, SCE_C_COMMENTDOC, SCE_C_COMMENTLINEDOC, SCE_C_COMMENTDOCKEYWORD, SCE_C_COMMENTDOCKEYWORDERROR, SCE_C_PREPROCESSORCOMMENT, SCE_C_PREPROCESSORCOMMENTDOC
+	// SCE_C_STRING, SCE_C_CHARACTER, SCE_C_STRINGEOL, SCE_C_VERBATIM, SCE_C_REGEX, SCE_C_STRINGRAW, SCE_C_TRIPLEVERBATIM, SCE_C_HASHQUOTEDSTRING
+	{ "cpp", { 1, 2, 3, 15, 17, 18, 23, 24 }, { 6, 7, 12, 13, 14, 20, 21, 22 } },
+};
+
+static const wchar_t *featureNames[StyleFilter::FeatureCount] = { L"Completion", L"Hover" };
+static const wchar_t *regionNames[StyleFilter::RegionCount] = { L"Code", L"Comment", L"String" };
+static const char *metricNames[StyleFilter::FeatureCount][StyleFilter::RegionCount] = {
+	{ "completion.avoided.code", "completion.avoided.comment", "completion.avoided.string" },
+	{ "hover.avoided.code", "hover.avoided.comment", "hover.avoided.string" },
+};
+
+static std::vector<int> ParseStyles(const wchar_t *text) {
+	std::vector<int> styles;
+	wchar_t *end;
+
+	while (*text) {
+		long style = std::wcstol(text, &end, 10);
+		if (end == text) {
+			text++;
+			continue;
+		}
+
+		if (style >= 0 && style < 256)
+			styles.push_back(style);
+		text = end;
+	}
+
+	return styles;
+}
+
+static StyleFilter::Action ParseAction(const wchar_t *text, StyleFilter::Action fallback) {
+	if (_wcsicmp(text, L"allow") == 0)
+		return StyleFilter::Allow;
+	else if (_wcsicmp(text, L"downgrade") == 0)
+		return StyleFilter::Downgrade;
+	else if (_wcsicmp(text, L"skip") == 0)
+		return StyleFilter::Skip;
+	return fallback;
+}
+
+StyleFilter::StyleFilter(ScintillaGateway &editor) : editor(editor) {
+}
+
+void StyleFilter::SetConfigFile(const std::wstring &path) {
+	iniPath = path;
+	languages.clear();
+	current = nullptr;
+
+	// Reload whatever was being used
+	if (!current_language.empty())
+		SetLanguage(current_language);
+}
+
+void StyleFilter::SetLanguage(const std::string &language) {
+	auto it = languages.find(language);
+
+	if (it == languages.end())
+		it = languages.emplace(language, Load(language)).first;
+
+	current = &it->second;
+	current_language = language;
+}
+
+bool StyleFilter::ShouldRequest(Feature feature, int position, bool explicitly) {
+	if (current == nullptr)
+		return true;
+
+	// Completions care about what has already been typed
+	if (feature == Completion && position > 0)
+		position--;
+
+	// Make sure what was just typed has been lexed
+	if (editor.GetEndStyled() <= position)
+		editor.Colourise(editor.PositionFromLine(editor.LineFromPosition(position)), position + 1);
+
+	Region region = static_cast<Region>(current->regions[editor.GetStyleAt(position) & 0xFF]);
+	Action action = current->actions[feature][region];
+
+	if (action == Allow || (action == Downgrade && explicitly))
+		return true;
+
+	Metrics::Global().Increment(metricNames[feature][region]);
+
+	return false;
+}
+
+StyleFilter::Language StyleFilter::Load(const std::string &name) const {
+	Language language;
+	std::fill(std::begin(language.regions), std::end(language.regions), static_cast<unsigned char>(Code));
+
+	std::vector<int> comments;
+	std::vector<int> strings;
+	for (const auto &d : defaults) {
+		if (name == d.language) {
+			comments = d.comments;
+			strings = d.strings;
+		}
+	}
+
+	// Anything in the ini file overrides the defaults, e.g.
+	// [python]
+	// CommentStyles=1,12
+	// HoverInString=skip
+	std::wstring section(name.begin(), name.end());
+	wchar_t value[256];
+
+	if (GetPrivateProfileString(section.c_str(), L"CommentStyles", NULL, value, 256, iniPath.c_str()) > 0)
+		comments = ParseStyles(value);
+	if (GetPrivateProfileString(section.c_str(), L"StringStyles", NULL, value, 256, iniPath.c_str()) > 0)
+		strings = ParseStyles(value);
+
+	for (int style : comments)
+		language.regions[style] = Comment;
+	for (int style : strings)
+		language.regions[style] = String;
+
+	// Typing in strings can still be useful (e.g. dictionary keys) as long as the user asks for it
+	language.actions[Completion][Code] = Allow;
+	language.actions[Completion][Comment] = Skip;
+	language.actions[Completion][String] = Downgrade;
+	language.actions[Hover][Code] = Allow;
+	language.actions[Hover][Comment] = Skip;
+	language.actions[Hover][String] = Skip;
+
+	for (int f = 0; f < FeatureCount; ++f) {
+		for (int r = 0; r < RegionCount; ++r) {
+			std::wstring key = std::wstring(featureNames[f]) + L"In" + regionNames[r];
+
+			if (GetPrivateProfileString(section.c_str(), key.c_str(), NULL, value, 256, iniPath.c_str()) > 0)
+				language.actions[f][r] = ParseAction(value, language.actions[f][r]);
+		}
+	}
+
+	return language;
+}
@@ -0,0 +1,72 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "ScintillaGateway.h"
+
+// Decides whether a request is worth sending based on the lexer style at a
+// position, e.g. there is no point asking for hovers inside of comments.
+class StyleFilter final {
+public:
+	enum Feature {
+		Completion,
+		Hover,
+		FeatureCount
+	};
+
+	enum Region {
+		Code,
+		Comment,
+		String,
+		RegionCount
+	};
+
+	enum Action {
+		Allow,
+		Downgrade, // Only when explicitly asked for by the user
+		Skip
+	};
+
+	explicit StyleFilter(ScintillaGateway &editor);
+
+	// Per language settings are read from this ini file
+	void SetConfigFile(const std::wstring &path);
+
+	// Called when the lexer of the current document may have changed
+	void SetLanguage(const std::string &language);
+
+	bool ShouldRequest(Feature feature, int position, bool explicitly);
+
+private:
+	struct Language {
+		unsigned char regions[256];
+		Action actions[FeatureCount][RegionCount];
+	};
+
+	ScintillaGateway &editor;
+	std::wstring iniPath;
+	std::unordered_map<std::string, Language> languages;
+	Language *current = nullptr;
+	std::string current_language;
+
+	Language Load(const std::string &name) const;
+};
@@ -0,0 +1,72 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel(unsigned int now, unsigned int resolution, size_t slots) : wheel(slots), resolution(resolution), last(now) {
+}
+
+void TimerWheel::Schedule(int id, unsigned int now, unsigned int timeout) {
+	// Rounded up so it never fires early
+	unsigned long long since_tick = now - last + remainder;
+	unsigned long long expires = tick + (since_tick + timeout + resolution - 1) / resolution;
+	if (expires == tick)
+		expires++;
+
+	wheel[expires % wheel.size()].push_back({ id, expires });
+	count++;
+}
+
+void TimerWheel::Advance(unsigned int now, std::vector<int> &expired) {
+	// Unsigned so it keeps working when the tick count wraps
+	unsigned int elapsed = now - last + remainder;
+	unsigned long long ticks = elapsed / resolution;
+
+	last = now;
+	remainder = elapsed % resolution;
+
+	if (count == 0) {
+		tick += ticks;
+		return;
+	}
+
+	// Once around is enough to see every slot
+	unsigned long long passed = ticks < wheel.size() ? ticks : wheel.size();
+	unsigned long long target = tick + ticks;
+
+	for (unsigned long long i = 1; i <= passed; ++i) {
+		tick = target - passed + i;
+		Expire(wheel[tick % wheel.size()], expired);
+	}
+
+	tick = target;
+}
+
+void TimerWheel::Expire(std::vector<Timer> &slot, std::vector<int> &expired) {
+	size_t kept = 0;
+
+	for (size_t i = 0; i < slot.size(); ++i) {
+		if (slot[i].tick <= tick)
+			expired.push_back(slot[i].id);
+		else
+			slot[kept++] = slot[i];
+	}
+
+	count -= slot.size() - kept;
+	slot.resize(kept);
+}
@@ -0,0 +1,55 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Keeps track of when things expire without keeping them sorted. Time is cut into
+// ticks and every tick has a slot on the wheel, scheduling something drops it into
+// the slot of the tick it expires on, and advancing the wheel only has to look at
+// the slots that were passed over. Deadlines longer than a full turn of the wheel
+// just stay in their slot until the turn they actually expire on.
+class TimerWheel final {
+public:
+	// Times are in milliseconds, as given by GetTickCount
+	TimerWheel(unsigned int now, unsigned int resolution = 10, size_t slots = 256);
+
+	void Schedule(int id, unsigned int now, unsigned int timeout);
+
+	// Moves the wheel up to now and appends whatever expired on the way
+	void Advance(unsigned int now, std::vector<int> &expired);
+
+	bool Empty() const { return count == 0; }
+
+private:
+	struct Timer {
+		int id;
+		unsigned long long tick;
+	};
+
+	std::vector<std::vector<Timer>> wheel;
+	unsigned int resolution;
+	unsigned int last;
+	unsigned int remainder = 0;
+	unsigned long long tick = 0;
+	size_t count = 0;
+
+	void Expire(std::vector<Timer> &slot, std::vector<int> &expired);
+};
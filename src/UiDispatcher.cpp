@@ -0,0 +1,106 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "UiDispatcher.h"
+#include "Metrics.h"
+
+#include <chrono>
+
+UiDispatcher &UiDispatcher::Global() {
+	static UiDispatcher dispatcher;
+	return dispatcher;
+}
+
+UiDispatcher::UiDispatcher() : posted(0), drained(0), overruns(0) {
+	Node *dummy = new Node();
+	dummy->next.store(nullptr, std::memory_order_relaxed);
+
+	head.store(dummy, std::memory_order_relaxed);
+	tail = dummy;
+}
+
+UiDispatcher::~UiDispatcher() {
+	Task task;
+	while (Pop(task)) {
+	}
+
+	delete tail;
+}
+
+void UiDispatcher::Post(Task task) {
+	Node *node = new Node();
+	node->next.store(nullptr, std::memory_order_relaxed);
+	node->task = std::move(task);
+
+	// Until the link is made the consumer just sees the queue ending before this node
+	Node *previous = head.exchange(node, std::memory_order_acq_rel);
+	previous->next.store(node, std::memory_order_release);
+
+	posted.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool UiDispatcher::Pop(Task &task) {
+	Node *next = tail->next.load(std::memory_order_acquire);
+	if (next == nullptr)
+		return false;
+
+	// The node that was popped becomes the new dummy
+	task = std::move(next->task);
+	next->task = nullptr;
+	delete tail;
+	tail = next;
+
+	return true;
+}
+
+size_t UiDispatcher::Drain(unsigned int budget) {
+	auto start = std::chrono::steady_clock::now();
+	auto limit = std::chrono::milliseconds(budget);
+	size_t count = 0;
+	Task task;
+
+	// At least one task is always run so the queue keeps moving whatever the budget is
+	while (Pop(task)) {
+		task();
+		count++;
+
+		if (std::chrono::steady_clock::now() - start >= limit)
+			break;
+	}
+
+	// Ran out of time with work still waiting, it is carried over to the next frame
+	if (tail->next.load(std::memory_order_acquire) != nullptr)
+		overruns.fetch_add(1, std::memory_order_relaxed);
+
+	drained.fetch_add(static_cast<long long>(count), std::memory_order_relaxed);
+
+	ReportMetrics();
+
+	return count;
+}
+
+void UiDispatcher::ReportMetrics() {
+	long long value;
+
+	if ((value = posted.exchange(0, std::memory_order_relaxed)) != 0)
+		Metrics::Global().Increment("ui.posted", value);
+	if ((value = drained.exchange(0, std::memory_order_relaxed)) != 0)
+		Metrics::Global().Increment("ui.drained", value);
+	if ((value = overruns.exchange(0, std::memory_order_relaxed)) != 0)
+		Metrics::Global().Increment("ui.budget_overruns", value);
+}
@@ -0,0 +1,66 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+// Gets the results of background work back onto the UI thread, the only thread that
+// may touch Scintilla. Tasks are pushed onto a lock-free queue from any thread and
+// the UI thread drains it once per frame. A frame only spends so long applying
+// results, whatever is left over waits for the next one, so a burst of responses
+// turns into a few busy frames instead of one long freeze.
+class UiDispatcher final {
+public:
+	typedef std::function<void()> Task;
+
+	static UiDispatcher &Global();
+
+	UiDispatcher();
+	~UiDispatcher();
+
+	// Can be called from any thread
+	void Post(Task task);
+
+	// Called from the UI thread, runs tasks until the queue is empty or budget milliseconds
+	// have passed, but always at least one. Returns the number of tasks that were run.
+	size_t Drain(unsigned int budget);
+
+private:
+	// Producers swap themselves in at the head and then link the previous head to
+	// themselves, the single consumer follows the links from the tail. A dummy node
+	// means the queue is never really empty so the two ends never have to agree.
+	struct Node {
+		std::atomic<Node *> next;
+		Task task;
+	};
+
+	std::atomic<Node *> head;
+	Node *tail;
+
+	// Counted here so posting never takes the lock in Metrics, they are handed over
+	// to it from the UI thread while draining
+	std::atomic<long long> posted;
+	std::atomic<long long> drained;
+	std::atomic<long long> overruns;
+
+	bool Pop(Task &task);
+	void ReportMetrics();
+};
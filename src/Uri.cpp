@@ -0,0 +1,108 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "Uri.h"
+
+#include <windows.h>
+#include <cctype>
+#include <cstring>
+
+std::string PathToUri(const std::wstring &path) {
+	if (path.empty())
+		return std::string();
+
+	int size = WideCharToMultiByte(CP_UTF8, 0, path.c_str(), (int)path.length(), NULL, 0, NULL, NULL);
+	std::string utf8(size, '\0');
+	WideCharToMultiByte(CP_UTF8, 0, path.c_str(), (int)path.length(), &utf8[0], size, NULL, NULL);
+
+	static const char hex[] = "0123456789ABCDEF";
+	std::string uri = "file:///";
+
+	for (unsigned char c : utf8) {
+		if (c == '\\') {
+			uri += '/';
+		}
+		else if (isalnum(c) || strchr("-._~/:", c)) {
+			uri += c;
+		}
+		else {
+			uri += '%';
+			uri += hex[c >> 4];
+			uri += hex[c & 0xF];
+		}
+	}
+
+	return uri;
+}
+
+static int HexValue(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+std::wstring UriToPath(const std::string &uri) {
+	static const char prefix[] = "file:///";
+	if (uri.compare(0, sizeof(prefix) - 1, prefix) != 0)
+		return std::wstring();
+
+	std::string utf8;
+	for (size_t i = sizeof(prefix) - 1; i < uri.length(); ++i) {
+		char c = uri[i];
+		if (c == '/') {
+			utf8 += '\\';
+		}
+		else if (c == '%' && i + 2 < uri.length() && HexValue(uri[i + 1]) >= 0 && HexValue(uri[i + 2]) >= 0) {
+			utf8 += static_cast<char>(HexValue(uri[i + 1]) * 16 + HexValue(uri[i + 2]));
+			i += 2;
+		}
+		else {
+			utf8 += c;
+		}
+	}
+
+	if (utf8.empty())
+		return std::wstring();
+
+	int size = MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), (int)utf8.length(), NULL, 0);
+	std::wstring path(size, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, utf8.c_str(), (int)utf8.length(), &path[0], size);
+
+	return path;
+}
+
+UriId UriTable::Intern(const std::string &uri) {
+	auto it = ids.find(uri);
+	if (it != ids.end())
+		return it->second;
+
+	UriId id = static_cast<UriId>(uris.size());
+	uris.push_back(uri);
+	ids.emplace(uri, id);
+	return id;
+}
+
+bool UriTable::Find(const std::string &uri, UriId &id) const {
+	auto it = ids.find(uri);
+	if (it == ids.end())
+		return false;
+
+	id = it->second;
+	return true;
+}
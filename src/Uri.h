@@ -0,0 +1,47 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Converts a Windows file path into a file:// uri, e.g. C:\My Code\a.py -> file:///C:/My%20Code/a.py
+std::string PathToUri(const std::wstring &path);
+
+// Converts a file:// uri back into a Windows file path
+std::wstring UriToPath(const std::string &uri);
+
+typedef unsigned int UriId;
+
+// Gives each distinct uri a small integer so they can be compared and hashed cheaply
+class UriTable final {
+public:
+	UriId Intern(const std::string &uri);
+
+	// Returns false if the uri has never been interned
+	bool Find(const std::string &uri, UriId &id) const;
+
+	const std::string &Get(UriId id) const { return uris[id]; }
+	size_t Size() const { return uris.size(); }
+
+private:
+	std::vector<std::string> uris;
+	std::unordered_map<std::string, UriId> ids;
+};
@@ -0,0 +1,169 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "Utf8.h"
+#include "Cpu.h"
+
+#ifdef CPU_SSE2
+#include <immintrin.h>
+#endif
+
+// Every byte that is not a continuation byte (10xxxxxx) starts a character which takes
+// one UTF-16 code unit, unless it is the lead byte of a 4 byte sequence (11110xxx) in
+// which case it takes a surrogate pair.
+static size_t Utf16LengthScalar(const char *text, size_t length) {
+	size_t units = 0;
+
+	for (size_t i = 0; i < length; ++i) {
+		unsigned char c = static_cast<unsigned char>(text[i]);
+
+		if ((c & 0xC0) != 0x80)
+			units += c >= 0xF0 ? 2 : 1;
+	}
+
+	return units;
+}
+
+#ifdef CPU_SSE2
+
+// Each byte adds at most 2 to its lane so the 8 bit lanes are summed up before they can overflow
+static const size_t blocks_per_sum = 127;
+
+static size_t Utf16LengthSse2(const char *text, size_t length) {
+	const __m128i continuation = _mm_set1_epi8(-65); // 0xBF, the largest continuation byte
+	const __m128i four_byte_lead = _mm_set1_epi8(static_cast<char>(0xF0));
+	const __m128i zero = _mm_setzero_si128();
+
+	size_t units = 0;
+	size_t i = 0;
+
+	while (i + 16 <= length) {
+		__m128i sums = zero;
+
+		for (size_t block = 0; block < blocks_per_sum && i + 16 <= length; ++block, i += 16) {
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+
+			// Signed compare: continuation bytes are -128 to -65
+			__m128i starts = _mm_cmpgt_epi8(bytes, continuation);
+			__m128i pairs = _mm_cmpeq_epi8(_mm_max_epu8(bytes, four_byte_lead), bytes);
+
+			// The masks are -1 where true
+			sums = _mm_sub_epi8(sums, starts);
+			sums = _mm_sub_epi8(sums, pairs);
+		}
+
+		__m128i total = _mm_sad_epu8(sums, zero);
+		units += _mm_cvtsi128_si32(total) + _mm_cvtsi128_si32(_mm_srli_si128(total, 8));
+	}
+
+	return units + Utf16LengthScalar(text + i, length - i);
+}
+
+static size_t Utf16LengthAvx2(const char *text, size_t length) {
+	const __m256i continuation = _mm256_set1_epi8(-65);
+	const __m256i four_byte_lead = _mm256_set1_epi8(static_cast<char>(0xF0));
+	const __m256i zero = _mm256_setzero_si256();
+
+	size_t units = 0;
+	size_t i = 0;
+
+	while (i + 32 <= length) {
+		__m256i sums = zero;
+
+		for (size_t block = 0; block < blocks_per_sum && i + 32 <= length; ++block, i += 32) {
+			__m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(text + i));
+
+			__m256i starts = _mm256_cmpgt_epi8(bytes, continuation);
+			__m256i pairs = _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, four_byte_lead), bytes);
+
+			sums = _mm256_sub_epi8(sums, starts);
+			sums = _mm256_sub_epi8(sums, pairs);
+		}
+
+		long long totals[4];
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(totals), _mm256_sad_epu8(sums, zero));
+		units += static_cast<size_t>(totals[0] + totals[1] + totals[2] + totals[3]);
+	}
+
+	return units + Utf16LengthSse2(text + i, length - i);
+}
+
+#endif
+
+size_t Utf16Length(const char *text, size_t length) {
+#ifdef CPU_SSE2
+	// Not worth setting up the registers for short text
+	if (length < 64)
+		return Utf16LengthScalar(text, length);
+
+	return CpuHasAvx2() ? Utf16LengthAvx2(text, length) : Utf16LengthSse2(text, length);
+#else
+	return Utf16LengthScalar(text, length);
+#endif
+}
+
+static bool IsAsciiScalar(const char *text, size_t length) {
+	for (size_t i = 0; i < length; ++i) {
+		if (static_cast<unsigned char>(text[i]) >= 0x80)
+			return false;
+	}
+
+	return true;
+}
+
+bool IsAscii(const char *text, size_t length) {
+#ifdef CPU_SSE2
+	size_t i = 0;
+
+	// The high bits of 64 bytes are or'ed together before checking them, bailing out
+	// early only matters for text that is mostly not ASCII anyway
+	while (i + 64 <= length) {
+		const __m128i *blocks = reinterpret_cast<const __m128i *>(text + i);
+		__m128i high = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(blocks), _mm_loadu_si128(blocks + 1)),
+			_mm_or_si128(_mm_loadu_si128(blocks + 2), _mm_loadu_si128(blocks + 3)));
+
+		if (_mm_movemask_epi8(high) != 0)
+			return false;
+
+		i += 64;
+	}
+
+	return IsAsciiScalar(text + i, length - i);
+#else
+	return IsAsciiScalar(text, length);
+#endif
+}
+
+size_t Utf8Length(const char *text, size_t length, size_t units) {
+	size_t i = 0;
+
+	while (i < length && units > 0) {
+		unsigned char c = static_cast<unsigned char>(text[i]);
+		size_t bytes = c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+		size_t width = bytes == 4 ? 2 : 1;
+
+		// Never stop in the middle of a surrogate pair
+		if (width > units)
+			break;
+
+		units -= width;
+		i += bytes;
+	}
+
+	return i < length ? i : length;
+}
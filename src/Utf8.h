@@ -0,0 +1,30 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <cstddef>
+
+// Number of UTF-16 code units needed for the UTF-8 text. Uses SSE2 or AVX2 when available.
+size_t Utf16Length(const char *text, size_t length);
+
+// True if none of the bytes are above 0x7F. Uses SSE2 when available.
+bool IsAscii(const char *text, size_t length);
+
+// Number of bytes of the UTF-8 text that make up the given number of UTF-16 code units
+size_t Utf8Length(const char *text, size_t length, size_t units);
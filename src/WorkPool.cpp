@@ -0,0 +1,141 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#include "WorkPool.h"
+#include "Metrics.h"
+
+static const int pool_size = 2;
+
+// Which of the pool's threads this is, if any
+static thread_local WorkPool *current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+WorkPool &WorkPool::Global() {
+	static WorkPool pool(pool_size);
+	return pool;
+}
+
+WorkPool::WorkPool(int threads) : thread_count(threads) {
+	for (int i = 0; i < threads; ++i)
+		workers.emplace_back(new Worker());
+}
+
+WorkPool::~WorkPool() {
+	// Stopped on NPPN_SHUTDOWN
+	for (auto &thread : threads)
+		thread.detach();
+}
+
+void WorkPool::Submit(Task task) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (stopping)
+			return;
+
+		if (threads.empty()) {
+			for (int i = 0; i < thread_count; ++i)
+				threads.emplace_back(&WorkPool::Run, this, static_cast<size_t>(i));
+		}
+
+		// Spread out what comes from elsewhere
+		size_t index = current_pool == this ? current_worker : next++ % workers.size();
+
+		// Counted before anyone can take it
+		std::lock_guard<std::mutex> worker_lock(workers[index]->mutex);
+		workers[index]->tasks.push_back(std::move(task));
+		queued++;
+	}
+
+	Metrics::Global().Increment("pool.tasks");
+	wake.notify_one();
+}
+
+void WorkPool::Stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wake.notify_all();
+
+	for (auto &thread : threads)
+		thread.join();
+
+	threads.clear();
+}
+
+bool WorkPool::Pop(size_t index, Task &task) {
+	Worker &worker = *workers[index];
+	std::lock_guard<std::mutex> lock(worker.mutex);
+
+	if (worker.tasks.empty())
+		return false;
+
+	// Newest first, whatever it needs is most likely still in the cache
+	task = std::move(worker.tasks.back());
+	worker.tasks.pop_back();
+	return true;
+}
+
+bool WorkPool::Steal(size_t index, Task &task) {
+	for (size_t i = 1; i < workers.size(); ++i) {
+		Worker &victim = *workers[(index + i) % workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			Metrics::Global().Increment("pool.steals");
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void WorkPool::Run(size_t index) {
+	current_pool = this;
+	current_worker = index;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return queued != 0 || stopping; });
+			if (stopping)
+				return;
+		}
+
+		Task task;
+		if (!Pop(index, task) && !Steal(index, task))
+			continue;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queued--;
+		}
+
+		// A task that throws must not take the thread down with it
+		try {
+			task();
+		}
+		catch (...) {
+			Metrics::Global().Increment("pool.task_failures");
+		}
+	}
+}
@@ -0,0 +1,69 @@
+// This file is part of NppLsp.
+// 
+// Copyright (C)2018 Justin Dailey <dail8859@yahoo.com>
+// 
+// NppLsp is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A few threads for the work of turning responses into something that can be shown
+// (parsing, sorting, rendering) so the UI thread only has to apply the result.
+//
+// Every thread has its own queue. Work submitted from one of the threads goes on
+// the end of its own queue and is taken back off the end, while threads that run
+// out of work steal from the front of the others' queues.
+class WorkPool final {
+public:
+	typedef std::function<void()> Task;
+
+	static WorkPool &Global();
+
+	explicit WorkPool(int threads);
+	~WorkPool();
+
+	// The threads are started the first time something is submitted
+	void Submit(Task task);
+
+	// Waits for the threads to finish what they are doing, anything still queued is dropped
+	void Stop();
+
+private:
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	int thread_count;
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	size_t queued = 0;
+	size_t next = 0;
+	bool stopping = false;
+
+	void Run(size_t index);
+	bool Pop(size_t index, Task &task);
+	bool Steal(size_t index, Task &task);
+};
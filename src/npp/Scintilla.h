@@ -1051,6 +1051,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCN_HOTSPOTRELEASECLICK 2027
 #define SCN_FOCUSIN 2028
 #define SCN_FOCUSOUT 2029
+#define SCN_AUTOCSELECTIONCHANGE 2032
 #define SCN_SCROLLED 2080
 #define SCN_FOLDINGSTATECHANGED 2081
 /* --Autogenerated -- end of section automatically generated from Scintilla.iface */